@@ -0,0 +1,492 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <istream>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <iostream>
+
+#include "PushTransport.h"
+
+// A Push 2 that isn't there: records every MIDI message and display frame sent to it, answers
+// palette reads like the device, takes scripted pad/button/touch strip input, can be unplugged
+// and plugged back in, and makes each MIDI write and display transfer take a set time the way USB does. The whole UI runs against
+// it unchanged, so message counts and timings can be measured without hardware.
+//
+// Script lines (also accepted one at a time by runScriptLine):
+//   pad <note> [velocity]     press a pad (Note On, default velocity 127)
+//   release <note>            release a pad (Note Off)
+//   cc <controller> <value>   raw control change
+//   button <cc>               press and release a button
+//   touch <0-16383>           touch strip position (pitch bend)
+//   unplug                    pull the USB cable: ports close, the device forgets its LEDs and palette
+//   plug [ms]                 plug it back in; its MIDI ports show up <ms> later (default 0)
+//   wait <ms>                 pause the script
+//   # ...                     comment
+class FakePushTransport : public PushTransport {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int DISPLAY_LINES = 160;
+    static constexpr int DISPLAY_LINE_BYTES = 2048;
+    static constexpr int DEFAULT_USB_LATENCY_US = 125;   // one high-speed USB microframe
+    static constexpr size_t MAX_RECORDS = 1000000;       // counting goes on past this
+
+    struct MidiRecord {
+        Clock::time_point at;
+        std::vector<uint8_t> bytes;
+    };
+
+    struct FrameRecord {
+        Clock::time_point started;
+        Clock::time_point finished;
+        uint64_t hash;      // FNV-1a of the 160 line transfers as sent
+    };
+
+    // Sees every MIDI message written to the fake, on the writing thread
+    using MidiObserver = std::function<void(const uint8_t* data, size_t size, Clock::time_point at)>;
+
+private:
+    struct PaletteEntry {
+        uint8_t r = 0, g = 0, b = 0, w = 0;
+    };
+
+    mutable std::mutex fakeMutex;
+    MidiInput midiInput;
+    MidiObserver midiObserver;
+    bool midiOpen = false;
+    bool displayOpen = false;
+    bool streams = true;
+    int usbLatencyUs = DEFAULT_USB_LATENCY_US;
+
+    // Hot-plug
+    bool plugged = true;
+    Clock::time_point portsAppearAt;
+    PlugHandler plugHandler;
+    uint64_t unplugs = 0;
+
+    // What the device would show
+    uint8_t noteIndex[128] = {};
+    uint8_t ccIndex[128] = {};
+    PaletteEntry palette[128];
+
+    // Recording
+    std::vector<MidiRecord> midiLog;
+    uint64_t midiWrites = 0;
+    uint64_t midiMessages = 0;
+    uint64_t midiBytes = 0;
+    uint64_t noteMessages = 0;
+    uint64_t ccMessages = 0;
+    uint64_t sysexMessages = 0;
+
+    std::vector<FrameRecord> frames;
+    uint64_t frameCount = 0;
+    uint64_t displayTransfers = 0;
+    int frameLines = -1;                 // -1 = waiting for a frame header
+    Clock::time_point frameStarted;
+    uint64_t frameHash = 0;
+    double totalFrameMs = 0.0;
+    double worstFrameMs = 0.0;
+
+    std::atomic<bool> scriptStopped{false};
+
+    static size_t messageLength(const uint8_t* data, size_t size) {
+        uint8_t status = data[0];
+        if (status == 0xF0) {
+            size_t end = 1;
+            while (end < size && data[end] != 0xF7) end++;
+            return std::min(end + 1, size);
+        }
+        if ((status & 0xF0) == 0xC0 || (status & 0xF0) == 0xD0) return std::min<size_t>(2, size);
+        return std::min<size_t>(3, size);
+    }
+
+    static uint64_t fnv1a(uint64_t hash, const uint8_t* data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= data[i];
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    static uint8_t join(const uint8_t* data) {
+        return static_cast<uint8_t>((data[0] & 0x7F) | ((data[1] & 0x01) << 7));
+    }
+
+    // Caller must hold fakeMutex; appends any reply the device would send
+    void handleMessageLocked(const uint8_t* data, size_t size, Clock::time_point at,
+                             std::vector<std::vector<uint8_t>>& replies) {
+        midiMessages++;
+        if (midiLog.size() < MAX_RECORDS) {
+            midiLog.push_back(MidiRecord{at, std::vector<uint8_t>(data, data + size)});
+        }
+
+        uint8_t type = data[0] & 0xF0;
+        if (type == 0x90 && size == 3) {
+            noteMessages++;
+            noteIndex[data[1] & 0x7F] = data[2];
+        } else if (type == 0xB0 && size == 3) {
+            ccMessages++;
+            ccIndex[data[1] & 0x7F] = data[2];
+        } else if (data[0] == 0xF0) {
+            sysexMessages++;
+            if (size < 8) return;
+            uint8_t command = data[6];
+            if (command == 0x03 && size >= 17) {
+                // Set palette entry: index, then r, g, b, w as lsb/msb pairs
+                PaletteEntry& entry = palette[data[7] & 0x7F];
+                entry.r = join(data + 8);
+                entry.g = join(data + 10);
+                entry.b = join(data + 12);
+                entry.w = join(data + 14);
+            } else if (command == 0x04) {
+                // Get palette entry: the reply echoes the index and carries the entry
+                uint8_t index = data[7] & 0x7F;
+                const PaletteEntry& entry = palette[index];
+                replies.push_back({0xF0, 0x00, 0x21, 0x1D, 0x01, 0x01, 0x04, index,
+                                   static_cast<uint8_t>(entry.r & 0x7F), static_cast<uint8_t>(entry.r >> 7),
+                                   static_cast<uint8_t>(entry.g & 0x7F), static_cast<uint8_t>(entry.g >> 7),
+                                   static_cast<uint8_t>(entry.b & 0x7F), static_cast<uint8_t>(entry.b >> 7),
+                                   static_cast<uint8_t>(entry.w & 0x7F), static_cast<uint8_t>(entry.w >> 7),
+                                   0xF7});
+            }
+        }
+    }
+
+    // Caller must hold fakeMutex
+    bool presentLocked() const {
+        return plugged && Clock::now() >= portsAppearAt;
+    }
+
+    void simulateTransfer() {
+        int latencyUs;
+        {
+            std::lock_guard<std::mutex> lock(fakeMutex);
+            latencyUs = usbLatencyUs;
+        }
+        if (latencyUs > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(latencyUs));
+        }
+    }
+
+public:
+    const char* name() const override { return "fake Push 2"; }
+
+    bool initialize() override { return true; }
+
+    bool openMidi(MidiInput input) override {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        if (!presentLocked()) return false;
+        midiInput = std::move(input);
+        midiOpen = true;
+        return true;
+    }
+
+    bool openDisplay() override {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        if (!plugged) return false;
+        displayOpen = true;
+        frameLines = -1;
+        return true;
+    }
+
+    void close() override {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        midiOpen = false;
+        displayOpen = false;
+        midiInput = nullptr;
+    }
+
+    bool writeMidi(const uint8_t* data, size_t size) override {
+        simulateTransfer();
+        auto at = Clock::now();
+        std::vector<std::vector<uint8_t>> replies;
+        MidiInput input;
+        MidiObserver observer;
+        {
+            std::lock_guard<std::mutex> lock(fakeMutex);
+            if (!midiOpen) return false;
+            midiWrites++;
+            midiBytes += size;
+            for (size_t offset = 0; offset < size;) {
+                size_t length = messageLength(data + offset, size - offset);
+                handleMessageLocked(data + offset, length, at, replies);
+                offset += length;
+            }
+            input = midiInput;
+            observer = midiObserver;
+        }
+        if (observer) {
+            for (size_t offset = 0; offset < size;) {
+                size_t length = messageLength(data + offset, size - offset);
+                observer(data + offset, length, at);
+                offset += length;
+            }
+        }
+        if (input) {
+            for (const auto& reply : replies) input(reply.data(), reply.size());
+        }
+        return true;
+    }
+
+    bool acceptsMidiStreams() const override {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        return streams;
+    }
+
+    bool hasDisplay() const override {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        return displayOpen;
+    }
+
+    bool writeDisplay(const uint8_t* data, int size, unsigned int timeoutMs) override {
+        (void)timeoutMs;
+        simulateTransfer();
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        if (!displayOpen) return false;
+        displayTransfers++;
+        auto now = Clock::now();
+        if (size == 16 && data[0] == 0xFF && data[1] == 0xCC && data[2] == 0xAA && data[3] == 0x88) {
+            frameLines = 0;
+            frameStarted = now;
+            frameHash = 0xCBF29CE484222325ull;
+            return true;
+        }
+        if (frameLines < 0 || size != DISPLAY_LINE_BYTES) return true; // not part of a frame
+        frameHash = fnv1a(frameHash, data, static_cast<size_t>(size));
+        if (++frameLines == DISPLAY_LINES) {
+            frameCount++;
+            double frameMs = std::chrono::duration<double, std::milli>(now - frameStarted).count();
+            totalFrameMs += frameMs;
+            worstFrameMs = std::max(worstFrameMs, frameMs);
+            if (frames.size() < MAX_RECORDS) frames.push_back(FrameRecord{frameStarted, now, frameHash});
+            frameLines = -1;
+        }
+        return true;
+    }
+
+    bool isPresent() override {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        return presentLocked();
+    }
+
+    bool watchPlugEvents(PlugHandler handler) override {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        plugHandler = std::move(handler);
+        return true;
+    }
+
+    void stopPlugEvents() override {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        plugHandler = nullptr;
+    }
+
+    // Pull the cable: everything open fails from now on, and the device loses what it showed
+    void unplug() {
+        PlugHandler handler;
+        {
+            std::lock_guard<std::mutex> lock(fakeMutex);
+            if (!plugged) return;
+            plugged = false;
+            midiOpen = false;
+            displayOpen = false;
+            midiInput = nullptr;
+            std::memset(noteIndex, 0, sizeof(noteIndex));
+            std::memset(ccIndex, 0, sizeof(ccIndex));
+            for (PaletteEntry& entry : palette) entry = PaletteEntry{};
+            unplugs++;
+            handler = plugHandler;
+        }
+        if (handler) handler(false);
+    }
+
+    // Plug the cable back in; the USB device arrives now, its MIDI ports portDelayMs later
+    void plug(int portDelayMs = 0) {
+        PlugHandler handler;
+        {
+            std::lock_guard<std::mutex> lock(fakeMutex);
+            if (plugged) return;
+            plugged = true;
+            portsAppearAt = Clock::now() + std::chrono::milliseconds(std::max(0, portDelayMs));
+            handler = plugHandler;
+        }
+        if (handler) handler(true);
+    }
+
+    // Time each MIDI write and each display transfer takes; 0 = instant
+    void setUsbLatency(int microseconds) {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        usbLatencyUs = std::max(0, microseconds);
+    }
+
+    // Pretend to be a backend that takes one message per write (like WinMM)
+    void setAcceptsStreams(bool acceptsStreams) {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        streams = acceptsStreams;
+    }
+
+    void setMidiObserver(MidiObserver observer) {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        midiObserver = std::move(observer);
+    }
+
+    // Input as if it came from the device; false while MIDI is closed
+    bool injectMidi(const uint8_t* data, size_t size) {
+        MidiInput input;
+        {
+            std::lock_guard<std::mutex> lock(fakeMutex);
+            if (!midiOpen) return false;
+            input = midiInput;
+        }
+        if (input) input(data, size);
+        return static_cast<bool>(input);
+    }
+
+    bool pressPad(int note, int velocity = 127) {
+        const uint8_t message[3] = {0x90, static_cast<uint8_t>(note & 0x7F), static_cast<uint8_t>(velocity & 0x7F)};
+        return injectMidi(message, sizeof(message));
+    }
+
+    bool releasePad(int note) {
+        const uint8_t message[3] = {0x80, static_cast<uint8_t>(note & 0x7F), 0x00};
+        return injectMidi(message, sizeof(message));
+    }
+
+    bool controlChange(int cc, int value) {
+        const uint8_t message[3] = {0xB0, static_cast<uint8_t>(cc & 0x7F), static_cast<uint8_t>(value & 0x7F)};
+        return injectMidi(message, sizeof(message));
+    }
+
+    bool pressButton(int cc) {
+        return controlChange(cc, 127) && controlChange(cc, 0);
+    }
+
+    bool touchStrip(int position) {
+        position = std::max(0, std::min(16383, position));
+        const uint8_t message[3] = {0xE0, static_cast<uint8_t>(position & 0x7F), static_cast<uint8_t>(position >> 7)};
+        return injectMidi(message, sizeof(message));
+    }
+
+    // Run one script line; false (with a message) if it could not be understood
+    bool runScriptLine(const std::string& line, std::string& error) {
+        std::istringstream words(line);
+        std::string command;
+        if (!(words >> command) || command[0] == '#') return true;
+        int a = 0, b = 0;
+        bool delivered;
+        if (command == "pad" && words >> a) {
+            if (!(words >> b)) b = 127;
+            delivered = pressPad(a, b);
+        } else if (command == "release" && words >> a) {
+            delivered = releasePad(a);
+        } else if (command == "cc" && words >> a >> b) {
+            delivered = controlChange(a, b);
+        } else if (command == "button" && words >> a) {
+            delivered = pressButton(a);
+        } else if (command == "touch" && words >> a) {
+            delivered = touchStrip(a);
+        } else if (command == "unplug") {
+            unplug();
+            return true;
+        } else if (command == "plug") {
+            if (!(words >> a)) a = 0;
+            plug(a);
+            return true;
+        } else if (command == "wait" && words >> a) {
+            // Sleep in slices so stopScript() takes effect promptly
+            auto until = Clock::now() + std::chrono::milliseconds(a);
+            while (!scriptStopped.load() && Clock::now() < until) {
+                std::this_thread::sleep_for(std::min<Clock::duration>(until - Clock::now(), std::chrono::milliseconds(10)));
+            }
+            return true;
+        } else {
+            error = "cannot parse '" + line + "'";
+            return false;
+        }
+        if (!delivered) error = "MIDI is closed";
+        return delivered;
+    }
+
+    // Run a whole script; returns the number of lines that failed
+    int runScript(std::istream& script) {
+        std::string line;
+        int lineNumber = 0;
+        int failures = 0;
+        while (!scriptStopped.load() && std::getline(script, line)) {
+            lineNumber++;
+            std::string error;
+            if (!runScriptLine(line, error)) {
+                std::cerr << "Fake Push script line " << lineNumber << ": " << error << std::endl;
+                failures++;
+            }
+        }
+        return failures;
+    }
+
+    void stopScript() { scriptStopped.store(true); }
+
+    // What the device shows: palette index last sent for a pad note / button cc
+    uint8_t getPadIndex(int note) const {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        return noteIndex[note & 0x7F];
+    }
+
+    uint8_t getButtonIndex(int cc) const {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        return ccIndex[cc & 0x7F];
+    }
+
+    uint64_t getMidiMessageCount() const {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        return midiMessages;
+    }
+
+    uint64_t getFrameCount() const {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        return frameCount;
+    }
+
+    std::vector<MidiRecord> getMidiLog() const {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        return midiLog;
+    }
+
+    std::vector<FrameRecord> getFrames() const {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        return frames;
+    }
+
+    void clearRecording() {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        midiLog.clear();
+        frames.clear();
+        midiWrites = midiMessages = midiBytes = noteMessages = ccMessages = sysexMessages = 0;
+        frameCount = displayTransfers = 0;
+        totalFrameMs = worstFrameMs = 0.0;
+    }
+
+    void printStats() const {
+        std::lock_guard<std::mutex> lock(fakeMutex);
+        std::cout << "Fake Push: " << midiMessages << " MIDI messages (" << noteMessages << " note, " << ccMessages
+                  << " cc, " << sysexMessages << " SysEx), " << midiBytes << " bytes in " << midiWrites << " writes; "
+                  << frameCount << " display frames in " << displayTransfers << " transfers";
+        if (frameCount > 0) {
+            std::cout << ", frame transfer mean " << (totalFrameMs / frameCount) << " ms, worst " << worstFrameMs << " ms";
+        }
+        std::cout << "; USB latency " << usbLatencyUs << " us per transfer";
+        std::cout << "; " << (plugged ? "plugged in" : "unplugged") << ", " << unplugs << " unplugs" << std::endl;
+        if (frames.size() >= 2) {
+            double spanMs = std::chrono::duration<double, std::milli>(frames.back().started - frames.front().started).count();
+            std::cout << "  display frame interval mean " << (spanMs / (frames.size() - 1)) << " ms" << std::endl;
+        }
+    }
+};
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+#include "osc/OscOutboundPacketStream.h"
+#include "ip/UdpSocket.h"
+#include "ip/PacketListener.h"
+#include "ip/IpEndpointName.h"
+
+#include "FakePushTransport.h"
+#include "ResolumeTrackerOSC.h"
+
+// End-to-end latency of the running bridge, with the fake Push 2 in place of the device and a
+// local socket in place of Resolume. Two paths, each the way a performer feels it:
+//   pad -> OSC  a pad press injected into the fake Push, until the clip's connect datagram arrives
+//   OSC -> LED  a clip starting to play (a transport position sent to the bridge), until its pad's
+//               Note On reaches the fake Push
+// run() prints percentiles for both and returns false if either p99 is over its gate, so a build
+// can fail on a latency regression.
+class LatencyBench : private PacketListener {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        int samples = 200;              // per path
+        double padToOscGateMs = 5.0;    // p99 limits
+        double oscToLedGateMs = 25.0;
+        int intervalMs = 20;            // idle time between samples, longer than an LED frame
+    };
+
+private:
+    static constexpr int GRID = 8;
+    static constexpr int FIRST_PAD_NOTE = 36;
+    static constexpr int TIMEOUT_MS = 1000;     // a sample slower than this counts as lost
+
+    struct Path {
+        const char* name;
+        std::vector<double> ms;
+        int lost = 0;
+    };
+
+    // The fake Resolume: receives what the bridge sends, sends to the port the bridge listens on
+    UdpListeningReceiveSocket resolumeSocket;
+    UdpTransmitSocket bridgeSocket;
+    std::thread receiveThread;
+
+    std::mutex benchMutex;
+    std::condition_variable benchCondition;
+    std::string expectedAddress;    // connect datagram being waited for
+    int expectedNote = -1;          // pad Note On being waited for
+    bool arrived = false;
+    Clock::time_point arrivedAt;
+
+    void ProcessPacket(const char* data, int size, const IpEndpointName&) override {
+        auto at = Clock::now();
+        std::lock_guard<std::mutex> lock(benchMutex);
+        if (expectedAddress.empty() || arrived) return;
+        // Raw search so the address is found inside bundles too
+        const char* end = data + size;
+        if (std::search(data, end, expectedAddress.begin(), expectedAddress.end()) == end) return;
+        arrived = true;
+        arrivedAt = at;
+        benchCondition.notify_all();
+    }
+
+    void onPushMidi(const uint8_t* data, size_t size, Clock::time_point at) {
+        if (size != 3 || (data[0] & 0xF0) != 0x90 || data[2] == 0) return;
+        std::lock_guard<std::mutex> lock(benchMutex);
+        if (data[1] != expectedNote || arrived) return;
+        arrived = true;
+        arrivedAt = at;
+        benchCondition.notify_all();
+    }
+
+    void sendToBridge(const std::string& address, const char* text) {
+        char buffer[256];
+        osc::OutboundPacketStream packet(buffer, sizeof(buffer));
+        packet << osc::BeginMessage(address.c_str()) << text << osc::EndMessage;
+        bridgeSocket.Send(packet.Data(), packet.Size());
+    }
+
+    void sendToBridge(const std::string& address, float value) {
+        char buffer[256];
+        osc::OutboundPacketStream packet(buffer, sizeof(buffer));
+        packet << osc::BeginMessage(address.c_str()) << value << osc::EndMessage;
+        bridgeSocket.Send(packet.Data(), packet.Size());
+    }
+
+    static std::string clipAddress(int layer, int column, const char* leaf) {
+        return "/composition/layers/" + std::to_string(layer) + "/clips/" + std::to_string(column) + "/" + leaf;
+    }
+
+    // Arm before starting a sample, then wait for it; returns the latency, or a negative value if lost
+    void arm(const std::string& address, int note) {
+        std::lock_guard<std::mutex> lock(benchMutex);
+        expectedAddress = address;
+        expectedNote = note;
+        arrived = false;
+    }
+
+    double waitFor(Clock::time_point started) {
+        std::unique_lock<std::mutex> lock(benchMutex);
+        bool seen = benchCondition.wait_for(lock, std::chrono::milliseconds(TIMEOUT_MS), [this]() { return arrived; });
+        expectedAddress.clear();
+        expectedNote = -1;
+        if (!seen) return -1.0;
+        return std::chrono::duration<double, std::milli>(arrivedAt - started).count();
+    }
+
+    static void record(Path& path, double ms) {
+        if (ms < 0.0) {
+            path.lost++;
+        } else {
+            path.ms.push_back(ms);
+        }
+    }
+
+    // Nearest-rank percentile of sorted samples
+    static double percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0.0;
+        size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.999999);
+        return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+
+    static bool report(Path& path, double gateMs, int samples) {
+        std::sort(path.ms.begin(), path.ms.end());
+        double p99 = percentile(path.ms, 99.0);
+        // Losing more than 1% of samples is a failure too: they are the slowest ones
+        bool pass = !path.ms.empty() && p99 <= gateMs && path.lost * 100 <= samples;
+        std::cout << "  " << std::left << std::setw(12) << path.name << std::right << std::fixed << std::setprecision(2)
+                  << "p50 " << percentile(path.ms, 50.0) << " ms, p90 " << percentile(path.ms, 90.0)
+                  << " ms, p99 " << p99 << " ms, max " << (path.ms.empty() ? 0.0 : path.ms.back())
+                  << " ms, " << path.lost << " lost (gate p99 <= " << gateMs << " ms) "
+                  << (pass ? "ok" : "FAILED") << std::endl;
+        std::cout << std::defaultfloat;
+        return pass;
+    }
+
+public:
+    // Binds the fake Resolume's port right away, so nothing the bridge sends at startup bounces
+    LatencyBench(int resolumePort, int bridgePort)
+        : resolumeSocket(IpEndpointName("127.0.0.1", resolumePort), this),
+          bridgeSocket(IpEndpointName("127.0.0.1", bridgePort)) {
+        receiveThread = std::thread([this]() { resolumeSocket.Run(); });
+    }
+
+    ~LatencyBench() {
+        resolumeSocket.AsynchronousBreak();
+        if (receiveThread.joinable()) {
+            receiveThread.join();
+        }
+    }
+
+    LatencyBench(const LatencyBench&) = delete;
+    LatencyBench& operator=(const LatencyBench&) = delete;
+
+    // The bridge must be running in triggering mode with the grid at its origin
+    bool run(FakePushTransport& fake, ResolumeTracker& tracker, const Options& options) {
+        // A full 8x8 grid of named clips, so every pad maps to a clip and columns have hues
+        for (int layer = 1; layer <= GRID; ++layer) {
+            for (int column = 1; column <= GRID; ++column) {
+                std::string name = "Bench " + std::to_string(layer) + "." + std::to_string(column);
+                sendToBridge(clipAddress(layer, column, "name"), name.c_str());
+            }
+        }
+        auto deadline = Clock::now() + std::chrono::milliseconds(TIMEOUT_MS);
+        for (;;) {
+            {
+                auto trackerLock = tracker.readLock();
+                if (tracker.getColumnCount() >= GRID && tracker.getLayerCount() >= GRID) break;
+            }
+            if (Clock::now() > deadline) {
+                std::cerr << "Latency bench: the bridge did not pick up the clip grid" << std::endl;
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        fake.setMidiObserver([this](const uint8_t* data, size_t size, Clock::time_point at) {
+            onPushMidi(data, size, at);
+        });
+
+        Path padToOsc{"pad -> OSC", {}, 0};
+        Path oscToLed{"OSC -> LED", {}, 0};
+        auto interval = std::chrono::milliseconds(options.intervalMs);
+        std::cout << "Latency bench: " << options.samples << " samples per path..." << std::endl;
+        for (int i = 0; i < options.samples; ++i) {
+            // Walk the grid so a pad is not reused until its clip has long stopped playing
+            int layer = (i / GRID) % GRID + 1;
+            int column = i % GRID + 1;
+            int note = FIRST_PAD_NOTE + (layer - 1) * GRID + (column - 1);
+
+            arm(clipAddress(layer, column, "connect"), -1);
+            auto started = Clock::now();
+            fake.pressPad(note);
+            record(padToOsc, waitFor(started));
+            fake.releasePad(note);
+            std::this_thread::sleep_for(interval);
+
+            // The pad has to be dark for its Note On to mean the clip started
+            auto dark = Clock::now() + std::chrono::milliseconds(TIMEOUT_MS);
+            while (fake.getPadIndex(note) != 0 && Clock::now() < dark) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            arm(std::string(), note);
+            started = Clock::now();
+            sendToBridge(clipAddress(layer, column, "transport/position"), 0.5f);
+            record(oscToLed, waitFor(started));
+            std::this_thread::sleep_for(interval);
+        }
+        fake.setMidiObserver(nullptr);
+
+        bool pass = report(padToOsc, options.padToOscGateMs, options.samples);
+        pass = report(oscToLed, options.oscToLedGateMs, options.samples) && pass;
+        std::cout << "Latency bench " << (pass ? "passed" : "FAILED") << std::endl;
+        return pass;
+    }
+};
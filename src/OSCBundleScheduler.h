@@ -0,0 +1,157 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+// OSC time tags are 64-bit NTP timestamps: upper 32 bits are seconds since 1900-01-01,
+// lower 32 bits are the fractional second. The special value 1 means "immediately".
+static constexpr uint64_t OSC_TIMETAG_IMMEDIATE = 1;
+static constexpr uint64_t NTP_UNIX_EPOCH_OFFSET = 2208988800ULL; // seconds from 1900 to 1970
+
+// Dispatch stage for OSC bundles carrying a future time tag.
+// Due (or immediate) bundles are run inline by the caller, future ones are held
+// on a priority queue and run on a dedicated thread once their time tag is reached.
+class OSCBundleScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void()>;
+
+private:
+    struct ScheduledTask {
+        Clock::time_point deadline;
+        uint64_t sequence; // keeps bundles with the same time tag in arrival order
+        Task task;
+
+        bool operator>(const ScheduledTask& other) const {
+            if (deadline != other.deadline) return deadline > other.deadline;
+            return sequence > other.sequence;
+        }
+    };
+
+    // Sleep on the condition variable until this close to the deadline, then yield-spin.
+    // OS timers (especially the default Windows tick) are far coarser than a video frame.
+    static constexpr std::chrono::microseconds SPIN_THRESHOLD{2000};
+
+    std::priority_queue<ScheduledTask, std::vector<ScheduledTask>, std::greater<ScheduledTask>> tasks;
+    std::mutex tasksMutex;
+    std::condition_variable tasksCondition;
+    uint64_t nextSequence = 0;
+
+    std::thread schedulerThread;
+    std::atomic<bool> shouldStop{false};
+
+    // Statistics
+    std::atomic<uint64_t> scheduledCount{0};
+    std::atomic<uint64_t> immediateCount{0};
+    std::atomic<int64_t> maxLatenessUs{0};
+
+    void schedulerLoop() {
+        std::unique_lock<std::mutex> lock(tasksMutex);
+        while (!shouldStop.load()) {
+            if (tasks.empty()) {
+                tasksCondition.wait(lock, [this]() { return shouldStop.load() || !tasks.empty(); });
+                continue;
+            }
+
+            auto deadline = tasks.top().deadline;
+            auto now = Clock::now();
+            if (deadline - now > SPIN_THRESHOLD) {
+                // Coarse wait; wakes early if an earlier bundle is scheduled or we are stopped
+                tasksCondition.wait_until(lock, deadline - SPIN_THRESHOLD);
+                continue;
+            }
+
+            if (now < deadline) {
+                lock.unlock();
+                while (Clock::now() < deadline && !shouldStop.load()) {
+                    std::this_thread::yield();
+                }
+                lock.lock();
+                continue; // re-check: an earlier task may have been queued meanwhile
+            }
+
+            ScheduledTask next = std::move(const_cast<ScheduledTask&>(tasks.top()));
+            tasks.pop();
+            lock.unlock();
+
+            auto lateness = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - next.deadline).count();
+            if (lateness > maxLatenessUs.load()) maxLatenessUs.store(lateness);
+            next.task();
+
+            lock.lock();
+        }
+    }
+
+public:
+    OSCBundleScheduler() {
+        schedulerThread = std::thread(&OSCBundleScheduler::schedulerLoop, this);
+    }
+
+    ~OSCBundleScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(tasksMutex);
+            shouldStop.store(true);
+        }
+        tasksCondition.notify_all();
+        if (schedulerThread.joinable()) {
+            schedulerThread.join();
+        }
+    }
+
+    OSCBundleScheduler(const OSCBundleScheduler&) = delete;
+    OSCBundleScheduler& operator=(const OSCBundleScheduler&) = delete;
+
+    // Convert an OSC/NTP time tag to a point on the steady clock.
+    // Returns false for "immediately" and for time tags that are already due.
+    static bool timeTagToDeadline(uint64_t timeTag, Clock::time_point& deadline) {
+        if (timeTag <= OSC_TIMETAG_IMMEDIATE) return false;
+
+        uint64_t seconds = timeTag >> 32;
+        uint64_t fraction = timeTag & 0xFFFFFFFFULL;
+        if (seconds < NTP_UNIX_EPOCH_OFFSET) return false;
+
+        auto sinceEpoch = std::chrono::seconds(seconds - NTP_UNIX_EPOCH_OFFSET) +
+                          std::chrono::nanoseconds((fraction * 1000000000ULL) >> 32);
+        auto target = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(sinceEpoch));
+
+        auto delta = target - std::chrono::system_clock::now();
+        if (delta <= std::chrono::system_clock::duration::zero()) return false;
+
+        deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(delta);
+        return true;
+    }
+
+    // Run the task now if the time tag is immediate or in the past, otherwise hold it until due
+    void dispatch(uint64_t timeTag, Task task) {
+        Clock::time_point deadline;
+        if (!timeTagToDeadline(timeTag, deadline)) {
+            immediateCount++;
+            task();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(tasksMutex);
+            tasks.push({deadline, nextSequence++, std::move(task)});
+        }
+        scheduledCount++;
+        tasksCondition.notify_one();
+    }
+
+    size_t pendingCount() {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        return tasks.size();
+    }
+
+    uint64_t getScheduledCount() const { return scheduledCount.load(); }
+    uint64_t getImmediateCount() const { return immediateCount.load(); }
+    int64_t getMaxLatenessUs() const { return maxLatenessUs.load(); }
+};
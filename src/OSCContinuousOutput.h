@@ -0,0 +1,166 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <cstring>
+
+#include "OSCSender.h"
+#include "OSCPacket.h"
+
+// Output stage for continuous controllers (touch strip, encoders).
+// Each address keeps only its latest value and is sent at most maxRate times per second:
+// the first change after a quiet period goes out at once, changes within the interval are
+// coalesced and the last one is always sent when the interval expires.
+class OSCContinuousOutput {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Channel {
+        OSCPacket packet;       // prebuilt, argument patched on send
+        float pendingValue = 0.0f;
+        float sentValue = 0.0f;
+        bool hasPending = false;
+        bool everSent = false;
+        Clock::time_point lastSent;
+    };
+
+    OSCSender& sender;
+    std::vector<std::unique_ptr<Channel>> channels;
+    Clock::duration minInterval;
+
+    std::mutex channelMutex;
+    std::condition_variable channelCondition;
+    std::thread flushThread;
+    bool shouldStop = false;
+
+    // Statistics
+    uint64_t valuesReceived = 0;
+    uint64_t valuesSent = 0;
+
+    // Caller must hold channelMutex
+    void sendLocked(Channel& channel, Clock::time_point now) {
+        channel.hasPending = false;
+        channel.lastSent = now;
+        if (channel.everSent && channel.sentValue == channel.pendingValue) return;
+        channel.packet.patchFloat(channel.pendingValue);
+        sender.send(channel.packet, OSCUrgency::Deferred);
+        channel.sentValue = channel.pendingValue;
+        channel.everSent = true;
+        valuesSent++;
+    }
+
+    // Sends trailing values once their channel's interval has expired
+    void flushLoop() {
+        std::unique_lock<std::mutex> lock(channelMutex);
+        while (!shouldStop) {
+            auto now = Clock::now();
+            auto nextDue = Clock::time_point::max();
+            bool trailingSent = false;
+            for (auto& channel : channels) {
+                if (!channel->hasPending) continue;
+                auto due = channel->lastSent + minInterval;
+                if (due <= now) {
+                    sendLocked(*channel, now);
+                    trailingSent = true;
+                } else if (due < nextDue) {
+                    nextDue = due;
+                }
+            }
+            // A trailing value usually comes after the LED frame that would have flushed the bundle
+            if (trailingSent) {
+                sender.flush();
+            }
+            if (nextDue == Clock::time_point::max()) {
+                channelCondition.wait(lock);
+            } else {
+                channelCondition.wait_until(lock, nextDue);
+            }
+        }
+    }
+
+public:
+    OSCContinuousOutput(OSCSender& oscSender, double maxRateHz = 60.0) : sender(oscSender) {
+        setMaxRate(maxRateHz);
+        flushThread = std::thread(&OSCContinuousOutput::flushLoop, this);
+    }
+
+    ~OSCContinuousOutput() {
+        {
+            std::lock_guard<std::mutex> lock(channelMutex);
+            shouldStop = true;
+            // Never drop the final position
+            auto now = Clock::now();
+            for (auto& channel : channels) {
+                if (channel->hasPending) sendLocked(*channel, now);
+            }
+            sender.flush();
+        }
+        channelCondition.notify_all();
+        if (flushThread.joinable()) {
+            flushThread.join();
+        }
+    }
+
+    OSCContinuousOutput(const OSCContinuousOutput&) = delete;
+    OSCContinuousOutput& operator=(const OSCContinuousOutput&) = delete;
+
+    void setMaxRate(double maxRateHz) {
+        std::lock_guard<std::mutex> lock(channelMutex);
+        if (maxRateHz <= 0.0) {
+            minInterval = Clock::duration::zero();
+        } else {
+            minInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / maxRateHz));
+        }
+        channelCondition.notify_one();
+    }
+
+    // Look up or register a float parameter; returns a handle for set(). Registering allocates,
+    // so do it up front rather than on every controller message.
+    int channel(const OSCAddressTemplate& address, std::initializer_list<int> indices = {}) {
+        OSCPacket packet;
+        if (!packet.setAddress(address, indices) || !packet.setFloat(0.0f)) return -1;
+
+        std::lock_guard<std::mutex> lock(channelMutex);
+        for (size_t i = 0; i < channels.size(); ++i) {
+            const OSCPacket& existing = channels[i]->packet;
+            if (existing.argumentOffset == packet.argumentOffset &&
+                std::memcmp(existing.data, packet.data, packet.argumentOffset) == 0) {
+                return static_cast<int>(i);
+            }
+        }
+        auto newChannel = std::make_unique<Channel>();
+        newChannel->packet = packet;
+        channels.push_back(std::move(newChannel));
+        return static_cast<int>(channels.size() - 1);
+    }
+
+    // Last value wins; sent immediately if the channel has been quiet for a full interval
+    void set(int channelId, float value) {
+        std::lock_guard<std::mutex> lock(channelMutex);
+        if (channelId < 0 || channelId >= static_cast<int>(channels.size())) return;
+        Channel& channel = *channels[channelId];
+        valuesReceived++;
+        channel.pendingValue = value;
+
+        auto now = Clock::now();
+        if (!channel.hasPending && now - channel.lastSent >= minInterval) {
+            sendLocked(channel, now);
+            return;
+        }
+        if (!channel.hasPending) {
+            channel.hasPending = true;
+            channelCondition.notify_one();
+        }
+    }
+
+    void printStats() {
+        std::lock_guard<std::mutex> lock(channelMutex);
+        std::cout << "Continuous output: " << valuesReceived << " values in, " << valuesSent << " sent over "
+                  << channels.size() << " channels" << std::endl;
+    }
+};
@@ -11,8 +11,14 @@
 #include <functional>
 #include <chrono>
 #include <queue>
+#include <optional>
+#include <algorithm>
+#include <iostream>
+#include <atomic>
 
 #include "OSCSender.h"
+#include "OSCBundleScheduler.h"
+#include "OSCRelay.h"
 
 // Forward declaration
 //class ResolumeTracker;
@@ -28,6 +34,10 @@ struct OSCListenerMessage {
     std::vector<std::string> strings;
 };
 
+// Messages that arrived together (a single message or all messages of one bundle)
+// and must be applied to the tracker as one unit
+using OSCListenerBatch = std::vector<OSCListenerMessage>;
+
 class ResolumeOSCListener : public OscPacketListener {
 private:
     //std::function<void(const std::string&, const std::vector<float>&, const std::vector<int>&, const std::vector<std::string>&)> messageCallback;
@@ -39,15 +49,152 @@ private:
     std::map<std::string, OSCListenerMessage> pendingQueries;
     
     // Message queue
-    std::queue<OSCListenerMessage> messageQueue;
+    std::queue<OSCListenerBatch> messageQueue;
     std::mutex queueMutex;
     std::condition_variable queueCondition;
+
+    // Holds bundles whose time tag is in the future
+    OSCBundleScheduler bundleScheduler;
+
+    // Optional re-broadcast of the raw datagrams to downstream consumers
+    OSCRelay* relay = nullptr;
+
+    // Sees every decoded message before it is queued (e.g. the state sync engine)
+    std::function<void(const OSCListenerMessage&)> messageObserver;
+
+    // Receive-side loss counters
+    std::atomic<uint64_t> packetsReceived{0};
+    std::atomic<uint64_t> malformedPackets{0};
+    std::atomic<uint64_t> truncatedPackets{0};
+
+    // Decode a received message into an owned OSCListenerMessage (the packet buffer is reused by the socket)
+    static OSCListenerMessage parseMessage(const ReceivedMessage& m) {
+        OSCListenerMessage message;
+        message.hasValue = true;
+        message.address = m.AddressPattern();
+
+        // Parse arguments
+        ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
+        while (arg != m.ArgumentsEnd()) {
+            if (arg->IsFloat()) {
+                message.floats.push_back(arg->AsFloat());
+            } else if (arg->IsInt32()) {
+                message.integers.push_back(arg->AsInt32());
+            } else if (arg->IsString()) {
+                message.strings.push_back(std::string(arg->AsString()));
+            }
+            ++arg;
+        }
+        return message;
+    }
+
+    // Hand a message to a waiting query; returns true if it was consumed
+    bool resolveQuery(OSCListenerMessage& message) {
+        std::lock_guard<std::mutex> lock(queryMutex);
+        auto it = pendingQueries.find(message.address);
+        if (it != pendingQueries.end() && !it->second.hasValue) {
+            it->second = std::move(message);
+            queryCondition.notify_all();
+            return true;
+        }
+        return false;
+    }
+
+    // Route messages to waiting queries, and queue the rest as one batch
+    void dispatchBatch(OSCListenerBatch&& batch) {
+        if (messageObserver) {
+            for (const auto& message : batch) {
+                messageObserver(message);
+            }
+        }
+
+        // Don't queue query responses
+        batch.erase(std::remove_if(batch.begin(), batch.end(),
+            [this](OSCListenerMessage& message) { return resolveQuery(message); }), batch.end());
+        if (batch.empty()) return;
+
+        // Queue the batch for processing
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            messageQueue.push(std::move(batch));
+            queueCondition.notify_one();
+        }
+    }
+
+    // A nested bundle due later than its parent, decoded into its own batch
+    struct TimedBatch {
+        uint64_t timeTag;
+        OSCListenerBatch messages;
+    };
+
+    static bool isDue(uint64_t timeTag) {
+        OSCBundleScheduler::Clock::time_point deadline;
+        return !OSCBundleScheduler::timeTagToDeadline(timeTag, deadline);
+    }
+
+    // Decode a bundle into one batch, in element order. Nested bundles join the batch unless they
+    // are due strictly later than timeTag; those become batches of their own in later.
+    void collectBundle(const ReceivedBundle& b, uint64_t timeTag, OSCListenerBatch& messages, std::vector<TimedBatch>& later) {
+        ReceivedBundle::const_iterator iter = b.ElementsBegin();
+        while (iter != b.ElementsEnd()) {
+            if (iter->IsMessage()) {
+                messages.push_back(parseMessage(ReceivedMessage(*iter)));
+            } else if (iter->IsBundle()) {
+                ReceivedBundle nested(*iter);
+                // OSC: a nested bundle is never due before its parent
+                uint64_t nestedTag = std::max(timeTag, nested.TimeTag());
+                if (nestedTag == timeTag || (isDue(timeTag) && isDue(nestedTag))) {
+                    collectBundle(nested, timeTag, messages, later);
+                } else {
+                    // Index, not a reference: the recursion may grow later
+                    size_t index = later.size();
+                    later.push_back({nestedTag, {}});
+                    OSCListenerBatch nestedMessages;
+                    collectBundle(nested, nestedTag, nestedMessages, later);
+                    later[index].messages = std::move(nestedMessages);
+                }
+            }
+            ++iter;
+        }
+    }
     
 public:
     ResolumeOSCListener(OSCSender* sender = nullptr) 
         : oscSender(sender) {}
     
     void setOSCSender(OSCSender* sender) { oscSender = sender; }
+
+    // Set these before the receive socket starts running
+    void setRelay(OSCRelay* oscRelay) { relay = oscRelay; }
+    void setMessageObserver(std::function<void(const OSCListenerMessage&)> observer) { messageObserver = std::move(observer); }
+
+    // oscpack receives into a fixed buffer; a datagram that fills it was cut off by the socket
+    static constexpr int RECEIVE_BUFFER_SIZE = 4098;
+
+    virtual void ProcessPacket(const char* data, int size, const IpEndpointName& remoteEndpoint) override {
+        packetsReceived++;
+        if (size >= RECEIVE_BUFFER_SIZE) {
+            truncatedPackets++;
+        }
+        if (relay && size > 0) {
+            relay->forward(data, static_cast<size_t>(size));
+        }
+        try {
+            OscPacketListener::ProcessPacket(data, size, remoteEndpoint);
+        } catch (osc::Exception& e) {
+            // A bad packet must not take down the receive thread
+            malformedPackets++;
+#ifdef DEBUG_OSC
+            std::cerr << "Malformed OSC packet: " << e.what() << std::endl;
+#else
+            (void)e;
+#endif
+        }
+    }
+
+    uint64_t getPacketsReceived() const { return packetsReceived.load(); }
+    uint64_t getMalformedPackets() const { return malformedPackets.load(); }
+    uint64_t getTruncatedPackets() const { return truncatedPackets.load(); }
     
     //void setMessageCallback(std::function<void(const std::string&, const std::vector<float>&, const std::vector<int>&, const std::vector<std::string>&)> callback) {
     //    messageCallback = callback;
@@ -126,101 +273,69 @@ public:
         std::lock_guard<std::mutex> lock(queueMutex);
         std::vector<OSCListenerMessage> messages;
         while (!messageQueue.empty()) {
-            messages.push_back(messageQueue.front());
+            for (auto& message : messageQueue.front()) {
+                messages.push_back(std::move(message));
+            }
             messageQueue.pop();
         }
         return messages;
     }
     
-    // Replace the waitForMessages method with this simpler approach:
-    std::optional<OSCListenerMessage> getNextMessage() {
+    // Get the next message or bundle; all messages of a bundle are returned together
+    std::optional<OSCListenerBatch> getNextBatch() {
         std::lock_guard<std::mutex> lock(queueMutex);
         if (messageQueue.empty()) {
             return std::nullopt;
         }
-        OSCListenerMessage message = messageQueue.front();
+        OSCListenerBatch batch = std::move(messageQueue.front());
         messageQueue.pop();
-        return message;
+        return batch;
     }
 
     void clearMessageQueue() {
         std::lock_guard<std::mutex> lock(queueMutex);
-        std::queue<OSCListenerMessage> empty;
+        std::queue<OSCListenerBatch> empty;
         std::swap(messageQueue, empty);
     }
 
 protected:
     virtual void ProcessMessage(const ReceivedMessage& m, const IpEndpointName& remoteEndpoint) override {
         try {
-            std::string address(m.AddressPattern());
-            std::vector<float> floats;
-            std::vector<int> integers;
-            std::vector<std::string> strings;
-            
-            // Parse arguments
-            ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
-            while (arg != m.ArgumentsEnd()) {
-                if (arg->IsFloat()) {
-                    floats.push_back(arg->AsFloat());
-                } else if (arg->IsInt32()) {
-                    integers.push_back(arg->AsInt32());
-                } else if (arg->IsString()) {
-                    strings.push_back(std::string(arg->AsString()));
-                }
-                ++arg;
-            }
-            
-            // Check if this is a response to a pending query
-            {
-                std::lock_guard<std::mutex> lock(queryMutex);
-                auto it = pendingQueries.find(address);
-                if (it != pendingQueries.end() && !it->second.hasValue) {
-                    it->second.hasValue = true;
-                    it->second.address = address;
-                    it->second.floats = floats;
-                    it->second.integers = integers;
-                    it->second.strings = strings;
-                    queryCondition.notify_all();
-                    return; // Don't queue query responses
-                }
-            }
-            
-            // Queue the message for processing
-            {
-                std::lock_guard<std::mutex> lock(queueMutex);
-                messageQueue.push({true, address, floats, integers, strings});
-                queueCondition.notify_one();
-            }
-            
+            OSCListenerMessage message = parseMessage(m);
+
             // Debug output
             #ifdef DEBUG_OSC
-                std::cout << "Received: " << address;
-                if (!floats.empty()) {
+                std::cout << "Received: " << message.address;
+                if (!message.floats.empty()) {
                     std::cout << " floats=[";
-                    for (size_t i = 0; i < floats.size(); ++i) {
+                    for (size_t i = 0; i < message.floats.size(); ++i) {
                         if (i > 0) std::cout << ", ";
-                        std::cout << floats[i];
+                        std::cout << message.floats[i];
                     }
                     std::cout << "]";
                 }
-                if (!integers.empty()) {
+                if (!message.integers.empty()) {
                     std::cout << " integers=[";
-                    for (size_t i = 0; i < integers.size(); ++i) {
+                    for (size_t i = 0; i < message.integers.size(); ++i) {
                         if (i > 0) std::cout << ", ";
-                        std::cout << integers[i];
+                        std::cout << message.integers[i];
                     }
                     std::cout << "]";
                 }
-                if (!strings.empty()) {
+                if (!message.strings.empty()) {
                     std::cout << " strings=[";
-                    for (size_t i = 0; i < strings.size(); ++i) {
+                    for (size_t i = 0; i < message.strings.size(); ++i) {
                         if (i > 0) std::cout << ", ";
-                        std::cout << "\"" << strings[i] << "\"";
+                        std::cout << "\"" << message.strings[i] << "\"";
                     }
                     std::cout << "]";
                 }
                 std::cout << std::endl;
             #endif
+
+            OSCListenerBatch batch;
+            batch.push_back(std::move(message));
+            dispatchBatch(std::move(batch));
             
         } catch (Exception& e) {
             std::cerr << "Error parsing OSC message: " << e.what() << std::endl;
@@ -228,15 +343,27 @@ protected:
     }
     
     virtual void ProcessBundle(const ReceivedBundle& b, const IpEndpointName& remoteEndpoint) override {
-        // Process each element in the bundle
-        ReceivedBundle::const_iterator iter = b.ElementsBegin();
-        while (iter != b.ElementsEnd()) {
-            if (iter->IsMessage()) {
-                ProcessMessage(ReceivedMessage(*iter), remoteEndpoint);
-            } else if (iter->IsBundle()) {
-                ProcessBundle(ReceivedBundle(*iter), remoteEndpoint);
+        try {
+            // Decode now: the receive buffer is only valid for the duration of this call
+            OSCListenerBatch messages;
+            std::vector<TimedBatch> later;
+            collectBundle(b, b.TimeTag(), messages, later);
+
+            // Apply immediately if the time tag is "now" or already past, otherwise at the time tag.
+            // The whole bundle is one batch, so the tracker applies it as a single state version.
+            if (!messages.empty()) {
+                bundleScheduler.dispatch(b.TimeTag(), [this, messages = std::move(messages)]() mutable {
+                    dispatchBatch(std::move(messages));
+                });
             }
-            ++iter;
+            for (auto& timed : later) {
+                if (timed.messages.empty()) continue;
+                bundleScheduler.dispatch(timed.timeTag, [this, messages = std::move(timed.messages)]() mutable {
+                    dispatchBatch(std::move(messages));
+                });
+            }
+        } catch (Exception& e) {
+            std::cerr << "Error parsing OSC bundle: " << e.what() << std::endl;
         }
     }
 };
\ No newline at end of file
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <iostream>
+#include <cstdint>
+
+#include "OSCListener.h"
+#include "OSCTcpStream.h"
+
+// Watches for OSC packets we never saw or could not use: kernel drops on the receive socket
+// (Linux /proc/net/udp), datagrams truncated by the receive buffer, malformed packets and broken
+// TCP frames. Any increase calls the loss handler, at most once per MIN_RESYNC_INTERVAL_MS;
+// losses during the hold-off are reported when it expires.
+class OSCLossMonitor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int POLL_INTERVAL_MS = 250;
+    static constexpr int MIN_RESYNC_INTERVAL_MS = 1000;
+
+private:
+    struct Counters {
+        int64_t kernelDrops = -1; // -1 = not available on this platform
+        uint64_t truncated = 0;
+        uint64_t malformed = 0;
+        uint64_t streamErrors = 0;
+    };
+
+    int port;
+    ResolumeOSCListener& listener;
+    std::function<void(const std::string& reason)> lossHandler;
+    std::atomic<OSCTcpStream*> tcpStream{nullptr};
+
+    std::mutex monitorMutex;
+    std::condition_variable monitorCondition;
+    std::thread monitorThread;
+    bool shouldStop = false;
+
+    Counters baseline;   // counters when loss was last reported
+    Counters latest;
+    uint64_t lossEvents = 0;
+    Clock::time_point lastReported;
+
+    // Sum of the drop counters of all UDP sockets bound to our port
+    static int64_t readKernelDrops(int port) {
+#if defined(__linux__)
+        int64_t total = -1;
+        for (const char* path : {"/proc/net/udp", "/proc/net/udp6"}) {
+            std::ifstream file(path);
+            if (!file) continue;
+            std::string line;
+            std::getline(file, line); // header
+            while (std::getline(file, line)) {
+                std::istringstream fields(line);
+                std::string slot, local, token, last;
+                fields >> slot >> local;
+                size_t colon = local.rfind(':');
+                if (colon == std::string::npos) continue;
+                if (std::stoi(local.substr(colon + 1), nullptr, 16) != port) continue;
+                while (fields >> token) last = token; // drops is the last column
+                if (last.empty()) continue;
+                total = (total < 0 ? 0 : total) + std::stoll(last);
+            }
+        }
+        return total;
+#else
+        (void)port;
+        return -1;
+#endif
+    }
+
+    Counters sample() {
+        Counters counters;
+        counters.kernelDrops = readKernelDrops(port);
+        counters.truncated = listener.getTruncatedPackets();
+        counters.malformed = listener.getMalformedPackets();
+        if (OSCTcpStream* stream = tcpStream.load()) {
+            OSCTcpStats stats = stream->getStats();
+            counters.streamErrors = stats.oversizedPackets + stats.framingErrors;
+        }
+        return counters;
+    }
+
+    // Caller must hold monitorMutex; empty if nothing was lost since the baseline
+    std::string describeLoss() const {
+        std::ostringstream reason;
+        if (latest.kernelDrops > baseline.kernelDrops && baseline.kernelDrops >= 0) {
+            reason << (latest.kernelDrops - baseline.kernelDrops) << " dropped by the kernel ";
+        }
+        if (latest.truncated > baseline.truncated) {
+            reason << (latest.truncated - baseline.truncated) << " truncated ";
+        }
+        if (latest.malformed > baseline.malformed) {
+            reason << (latest.malformed - baseline.malformed) << " malformed ";
+        }
+        if (latest.streamErrors > baseline.streamErrors) {
+            reason << (latest.streamErrors - baseline.streamErrors) << " bad tcp frames ";
+        }
+        return reason.str();
+    }
+
+    void monitorLoop() {
+        std::unique_lock<std::mutex> lock(monitorMutex);
+        baseline = sample();
+        latest = baseline;
+        while (!shouldStop) {
+            monitorCondition.wait_for(lock, std::chrono::milliseconds(POLL_INTERVAL_MS));
+            if (shouldStop) break;
+
+            latest = sample();
+            if (latest.kernelDrops >= 0 && baseline.kernelDrops < 0) {
+                baseline.kernelDrops = latest.kernelDrops; // socket appeared after we started
+            }
+            std::string reason = describeLoss();
+            if (reason.empty()) continue;
+
+            auto now = Clock::now();
+            if (lossEvents > 0 && now - lastReported < std::chrono::milliseconds(MIN_RESYNC_INTERVAL_MS)) {
+                continue; // keep the baseline, report once the hold-off expires
+            }
+            baseline = latest;
+            lastReported = now;
+            lossEvents++;
+
+            lock.unlock();
+            std::cout << "OSC packet loss detected (" << reason << ")" << std::endl;
+            if (lossHandler) {
+                lossHandler(reason);
+            }
+            lock.lock();
+        }
+    }
+
+public:
+    OSCLossMonitor(int udpPort, ResolumeOSCListener& oscListener, std::function<void(const std::string& reason)> handler)
+        : port(udpPort), listener(oscListener), lossHandler(std::move(handler)) {
+        monitorThread = std::thread(&OSCLossMonitor::monitorLoop, this);
+    }
+
+    ~OSCLossMonitor() {
+        {
+            std::lock_guard<std::mutex> lock(monitorMutex);
+            shouldStop = true;
+        }
+        monitorCondition.notify_all();
+        if (monitorThread.joinable()) {
+            monitorThread.join();
+        }
+    }
+
+    OSCLossMonitor(const OSCLossMonitor&) = delete;
+    OSCLossMonitor& operator=(const OSCLossMonitor&) = delete;
+
+    // Also watch an OSC-over-TCP stream for broken frames; nullptr to detach
+    void setTcpStream(OSCTcpStream* stream) { tcpStream.store(stream); }
+
+    void printStats() {
+        std::lock_guard<std::mutex> lock(monitorMutex);
+        std::cout << "Loss monitor: " << lossEvents << " loss events, kernel drops "
+                  << (latest.kernelDrops >= 0 ? std::to_string(latest.kernelDrops) : std::string("n/a"))
+                  << ", truncated " << latest.truncated << ", malformed " << latest.malformed
+                  << ", bad tcp frames " << latest.streamErrors << ", " << listener.getPacketsReceived()
+                  << " packets received" << std::endl;
+    }
+};
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <initializer_list>
+
+// Allocation-free OSC encoding for the single-argument messages this bridge sends.
+// Type tags and padding are fixed blocks; only the address digits and argument bytes change per send.
+
+namespace OSCEncoding {
+    static constexpr char TYPETAG_INT[4]    = {',', 'i', '\0', '\0'};
+    static constexpr char TYPETAG_FLOAT[4]  = {',', 'f', '\0', '\0'};
+    static constexpr char TYPETAG_STRING[4] = {',', 's', '\0', '\0'};
+
+    // Size of an OSC string including its null terminator, rounded up to 4 bytes
+    constexpr size_t paddedSize(size_t length) { return (length + 4) & ~static_cast<size_t>(3); }
+
+    inline void writeUInt32BE(char* dst, uint32_t value) {
+        dst[0] = static_cast<char>((value >> 24) & 0xFF);
+        dst[1] = static_cast<char>((value >> 16) & 0xFF);
+        dst[2] = static_cast<char>((value >> 8) & 0xFF);
+        dst[3] = static_cast<char>(value & 0xFF);
+    }
+
+    inline void writeFloatBE(char* dst, float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        writeUInt32BE(dst, bits);
+    }
+
+    // Write decimal digits of value to dst, returns the number of characters written (max 11)
+    inline size_t formatInt(char* dst, int value) {
+        char digits[12];
+        size_t count = 0;
+        uint32_t magnitude = value < 0 ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+        do {
+            digits[count++] = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude > 0);
+
+        size_t written = 0;
+        if (value < 0) dst[written++] = '-';
+        while (count > 0) dst[written++] = digits[--count];
+        return written;
+    }
+}
+
+// OSC address with "{}" placeholders for integer indices, e.g. "/composition/layers/{}/clips/{}/connect".
+// The pattern is validated at compile time; formatting writes straight into a caller buffer.
+class OSCAddressTemplate {
+public:
+    static constexpr size_t MAX_PLACEHOLDERS = 4;
+
+private:
+    const char* pattern;
+    size_t length = 0;
+    size_t placeholderOffsets[MAX_PLACEHOLDERS] = {};
+    size_t placeholderCount = 0;
+
+public:
+    consteval OSCAddressTemplate(const char* addressPattern) : pattern(addressPattern) {
+        if (pattern[0] != '/') throw "OSC address must start with '/'";
+        while (pattern[length] != '\0') {
+            if (pattern[length] == '{') {
+                if (pattern[length + 1] != '}') throw "Unterminated '{' in OSC address template";
+                if (placeholderCount == MAX_PLACEHOLDERS) throw "Too many placeholders in OSC address template";
+                placeholderOffsets[placeholderCount++] = length;
+                length += 2;
+                continue;
+            }
+            if (pattern[length] == '}') throw "Unmatched '}' in OSC address template";
+            ++length;
+        }
+    }
+
+    constexpr size_t placeholders() const { return placeholderCount; }
+    constexpr const char* getPattern() const { return pattern; }
+
+    // Worst-case formatted length (each placeholder becomes at most 11 characters)
+    constexpr size_t maxLength() const { return length - placeholderCount * 2 + placeholderCount * 11; }
+
+    // Format into dst (no null terminator written). Returns the address length, or 0 if the
+    // number of values does not match the pattern or dst is too small.
+    size_t format(char* dst, size_t capacity, std::initializer_list<int> values) const {
+        if (values.size() != placeholderCount || maxLength() > capacity) return 0;
+
+        size_t written = 0;
+        size_t source = 0;
+        const int* value = values.begin();
+        for (size_t i = 0; i < placeholderCount; ++i) {
+            size_t literal = placeholderOffsets[i] - source;
+            std::memcpy(dst + written, pattern + source, literal);
+            written += literal;
+            written += OSCEncoding::formatInt(dst + written, *value++);
+            source = placeholderOffsets[i] + 2;
+        }
+        std::memcpy(dst + written, pattern + source, length - source);
+        written += length - source;
+        return written;
+    }
+
+    // Formatted address as a string (allocates; for logging only)
+    std::string toString(std::initializer_list<int> values) const {
+        char buffer[256];
+        size_t size = format(buffer, sizeof(buffer), values);
+        return std::string(buffer, size);
+    }
+};
+
+// Fixed-capacity encoded OSC message. Lives on the stack or in preallocated storage, never on the heap.
+// A packet can be built once and then only have its argument bytes patched before each send.
+struct OSCPacket {
+    static constexpr size_t CAPACITY = 256;
+
+    char data[CAPACITY];
+    size_t size = 0;
+    size_t argumentOffset = 0; // start of the argument bytes, 0 if the packet has no argument yet
+
+    // Write the address string with its null padding
+    bool setAddress(const char* address, size_t addressLength) {
+        size_t padded = OSCEncoding::paddedSize(addressLength);
+        if (padded + 4 > CAPACITY) return false;
+        std::memcpy(data, address, addressLength);
+        std::memset(data + addressLength, 0, padded - addressLength);
+        size = padded;
+        argumentOffset = 0;
+        return true;
+    }
+
+    bool setAddress(const OSCAddressTemplate& address, std::initializer_list<int> values) {
+        size_t addressLength = address.format(data, CAPACITY - 8, values);
+        if (addressLength == 0) return false;
+        size_t padded = OSCEncoding::paddedSize(addressLength);
+        std::memset(data + addressLength, 0, padded - addressLength);
+        size = padded;
+        argumentOffset = 0;
+        return true;
+    }
+
+    bool setInt(int32_t value) {
+        if (!appendTypeTag(OSCEncoding::TYPETAG_INT, 4)) return false;
+        OSCEncoding::writeUInt32BE(data + argumentOffset, static_cast<uint32_t>(value));
+        return true;
+    }
+
+    bool setFloat(float value) {
+        if (!appendTypeTag(OSCEncoding::TYPETAG_FLOAT, 4)) return false;
+        OSCEncoding::writeFloatBE(data + argumentOffset, value);
+        return true;
+    }
+
+    bool setString(const char* value, size_t valueLength) {
+        size_t padded = OSCEncoding::paddedSize(valueLength);
+        if (!appendTypeTag(OSCEncoding::TYPETAG_STRING, padded)) return false;
+        std::memcpy(data + argumentOffset, value, valueLength);
+        std::memset(data + argumentOffset + valueLength, 0, padded - valueLength);
+        return true;
+    }
+
+    // Rewrite the argument of a packet previously built with setInt/setFloat
+    void patchInt(int32_t value) { OSCEncoding::writeUInt32BE(data + argumentOffset, static_cast<uint32_t>(value)); }
+    void patchFloat(float value) { OSCEncoding::writeFloatBE(data + argumentOffset, value); }
+
+private:
+    // Type tag goes right after the address; replaces any previous argument
+    bool appendTypeTag(const char (&typeTag)[4], size_t argumentSize) {
+        size_t addressEnd = argumentOffset ? argumentOffset - 4 : size;
+        if (addressEnd + 4 + argumentSize > CAPACITY) return false;
+        std::memcpy(data + addressEnd, typeTag, 4);
+        argumentOffset = addressEnd + 4;
+        size = argumentOffset + argumentSize;
+        return true;
+    }
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+
+#include "UdpFanout.h"
+
+// Re-broadcasts the raw OSC datagrams Resolume sends us to other consumers.
+// Packets are forwarded untouched straight from the receive buffer. Each target can be
+// limited to an address subtree and capped to a maximum packet rate.
+class OSCRelay {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Target {
+        std::string subtree;        // address prefix, empty = everything
+        double maxPacketsPerSecond; // 0 = unlimited
+    };
+
+private:
+    struct TargetState {
+        std::string subtree;
+        double maxPacketsPerSecond = 0.0;
+        double tokens = 0.0;        // token bucket, burst of one second
+        Clock::time_point lastRefill;
+        std::atomic<uint64_t> forwarded{0};
+        std::atomic<uint64_t> filtered{0};
+        std::atomic<uint64_t> rateLimited{0};
+    };
+
+    UdpFanoutSocket socket;
+    std::vector<std::unique_ptr<TargetState>> targets;
+    std::mutex forwardMutex; // UDP and TCP receive threads may both forward
+
+    // Read the null-terminated OSC string at data[offset], bounded by end
+    static bool readAddress(const char* data, size_t offset, size_t end, const char*& address, size_t& length) {
+        if (offset >= end) return false;
+        const void* terminator = std::memchr(data + offset, '\0', end - offset);
+        if (!terminator) return false;
+        address = data + offset;
+        length = static_cast<const char*>(terminator) - address;
+        return true;
+    }
+
+    static bool addressInSubtree(const char* address, size_t length, const std::string& subtree) {
+        if (length < subtree.size() || std::memcmp(address, subtree.data(), subtree.size()) != 0) return false;
+        // "/composition/layers/1" must not match "/composition/layers/10"
+        return length == subtree.size() || subtree.back() == '/' || address[subtree.size()] == '/';
+    }
+
+    // True if the message, or any message inside the bundle, lies in the subtree
+    static bool packetMatches(const char* data, size_t begin, size_t end, const std::string& subtree, int depth = 0) {
+        if (end - begin >= 16 && std::memcmp(data + begin, "#bundle", 8) == 0) {
+            if (depth > 8) return true;
+            size_t offset = begin + 16; // skip "#bundle\0" and the time tag
+            while (offset + 4 <= end) {
+                uint32_t elementSize = (static_cast<uint32_t>(static_cast<uint8_t>(data[offset])) << 24) |
+                                       (static_cast<uint32_t>(static_cast<uint8_t>(data[offset + 1])) << 16) |
+                                       (static_cast<uint32_t>(static_cast<uint8_t>(data[offset + 2])) << 8) |
+                                       static_cast<uint32_t>(static_cast<uint8_t>(data[offset + 3]));
+                offset += 4;
+                if (elementSize > end - offset) return false; // malformed
+                if (packetMatches(data, offset, offset + elementSize, subtree, depth + 1)) return true;
+                offset += elementSize;
+            }
+            return false;
+        }
+
+        const char* address;
+        size_t length;
+        if (!readAddress(data, begin, end, address, length)) return false;
+        return addressInSubtree(address, length, subtree);
+    }
+
+    bool takeToken(TargetState& target, Clock::time_point now) {
+        if (target.maxPacketsPerSecond <= 0.0) return true;
+        double elapsed = std::chrono::duration<double>(now - target.lastRefill).count();
+        target.lastRefill = now;
+        target.tokens = std::min(target.maxPacketsPerSecond, target.tokens + elapsed * target.maxPacketsPerSecond);
+        if (target.tokens < 1.0) return false;
+        target.tokens -= 1.0;
+        return true;
+    }
+
+public:
+    // Add targets before the listener starts receiving
+    bool addTarget(const std::string& address, int port, const Target& config) {
+        std::string name = address + ":" + std::to_string(port) + config.subtree;
+        if (socket.addDestination(IpEndpointName(address.c_str(), port), name) < 0) {
+            std::cerr << "OSC relay: too many targets, ignoring " << name << std::endl;
+            return false;
+        }
+        auto target = std::make_unique<TargetState>();
+        target->subtree = config.subtree;
+        target->maxPacketsPerSecond = config.maxPacketsPerSecond;
+        target->tokens = config.maxPacketsPerSecond;
+        target->lastRefill = Clock::now();
+        targets.push_back(std::move(target));
+        return true;
+    }
+
+    bool empty() const { return targets.empty(); }
+
+    // Called on the receive thread with the socket's buffer; never copies or re-encodes
+    void forward(const char* data, size_t size) {
+        if (targets.empty() || size == 0) return;
+
+        std::lock_guard<std::mutex> lock(forwardMutex);
+        auto now = Clock::now();
+        for (size_t i = 0; i < targets.size(); ++i) {
+            TargetState& target = *targets[i];
+            if (!target.subtree.empty() && !packetMatches(data, 0, size, target.subtree)) {
+                target.filtered++;
+                continue;
+            }
+            if (!takeToken(target, now)) {
+                target.rateLimited++;
+                continue;
+            }
+            if (socket.sendTo(i, data, size)) {
+                target.forwarded++;
+            }
+        }
+    }
+
+    void printStats() const {
+        auto socketStats = socket.getStats();
+        for (size_t i = 0; i < targets.size() && i < socketStats.size(); ++i) {
+            const TargetState& target = *targets[i];
+            std::cout << "  relay -> " << socketStats[i].name << ": " << target.forwarded.load() << " forwarded, "
+                      << target.filtered.load() << " filtered, " << target.rateLimited.load() << " rate limited, "
+                      << socketStats[i].errors << " errors" << std::endl;
+        }
+    }
+};
@@ -5,49 +5,417 @@
 #include "osc/OscPacketListener.h"
 #include "ip/UdpSocket.h"
 #include "ip/IpEndpointName.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <semaphore>
+
+#include "OSCPacket.h"
+#include "LockFreeQueue.h"
+#include "UdpFanout.h"
+#include "OSCTcpStream.h"
 
 using namespace osc;
 
 //#define DEBUG_OSC 1
 
-// OSC Sender implementation
+// Latency-critical messages flush any pending bundle immediately, deferred ones may wait for the bundle window
+enum class OSCUrgency {
+    Immediate,
+    Deferred
+};
+
+// Producer-side timing covers encoding and enqueueing; queue delay is measured on the sender
+// thread from enqueue until the datagram is handed to the socket
+struct OSCSenderStats {
+    uint64_t messagesSent = 0;
+    uint64_t datagramsSent = 0;
+    uint64_t bundlesSent = 0;
+    uint64_t encodeErrors = 0;
+    uint64_t droppedPackets = 0;
+    uint64_t droppedImmediate = 0;
+    uint64_t totalSendNs = 0;
+    uint64_t maxSendNs = 0;
+    uint64_t lastSendNs = 0;
+    uint64_t totalQueueDelayNs = 0;
+    uint64_t maxQueueDelayNs = 0;
+};
+
+// OSC Sender implementation.
+// Any thread may send: messages are encoded on the calling thread and handed to a dedicated
+// sender thread through a lock-free queue, so producers never block on each other or on the socket.
 class OSCSender {
 private:
-    UdpTransmitSocket socket;
-    IpEndpointName remoteEndpoint;
-    
+    using Clock = std::chrono::steady_clock;
+
+    // Pre-encoded packet waiting for the sender thread
+    struct QueuedPacket {
+        OSCPacket packet;
+        OSCUrgency urgency = OSCUrgency::Immediate;
+        Clock::time_point enqueued;
+    };
+    static constexpr size_t QUEUE_CAPACITY = 1024;
+    // Deferred packets may not take the last slots, so presses still get through a full queue
+    static constexpr size_t IMMEDIATE_RESERVE = 64;
+    static constexpr int DROP_REPORT_INTERVAL_MS = 1000;
+
+    // Resolume plus any mirrors (backup machine, lighting desk); each packet is encoded once
+    UdpFanoutSocket socket;
+
+    // Optional OSC-over-TCP peer that also receives every packet
+    std::atomic<OSCTcpStream*> stream{nullptr};
+
+    BoundedMPSCQueue<QueuedPacket, QUEUE_CAPACITY> sendQueue;
+    // One permit per queued packet, plus one for a pending flush and one for shutdown. Those two
+    // are flags rather than queue slots, so a full queue can never swallow them.
+    std::counting_semaphore<QUEUE_CAPACITY + 2> queuedCount{0};
+    std::atomic<bool> flushRequested{false};
+    std::thread senderThread;
+    std::atomic<bool> shouldStop{false};
+
+    std::atomic<uint64_t> messagesSent{0};
+    std::atomic<uint64_t> datagramsSent{0};
+    std::atomic<uint64_t> bundlesSent{0};
+    std::atomic<uint64_t> encodeErrors{0};
+    std::atomic<uint64_t> droppedPackets{0};
+    std::atomic<uint64_t> droppedImmediate{0};
+    uint64_t reportedImmediate = 0;     // sender thread only
+    Clock::time_point lastDropReport;
+    std::atomic<uint64_t> totalSendNs{0};
+    std::atomic<uint64_t> maxSendNs{0};
+    std::atomic<uint64_t> lastSendNs{0};
+    std::atomic<uint64_t> totalQueueDelayNs{0};
+    std::atomic<uint64_t> maxQueueDelayNs{0};
+
+    static void updateMax(std::atomic<uint64_t>& maxValue, uint64_t value) {
+        uint64_t previousMax = maxValue.load();
+        while (value > previousMax && !maxValue.compare_exchange_weak(previousMax, value)) {}
+    }
+
+    static uint64_t elapsedNs(Clock::time_point start) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+
+    void recordSendTime(Clock::time_point start) {
+        uint64_t ns = elapsedNs(start);
+        messagesSent++;
+        totalSendNs += ns;
+        lastSendNs.store(ns);
+        updateMax(maxSendNs, ns);
+    }
+
+    // Bundling: messages are collected into one OSC bundle and sent as a single datagram.
+    // Only touched by the sender thread.
+    static constexpr size_t MAX_BUNDLE_SIZE = 1472; // fits a standard Ethernet MTU
+    static constexpr size_t BUNDLE_HEADER_SIZE = 16; // "#bundle\0" + time tag
+    char bundleBuffer[MAX_BUNDLE_SIZE];
+    size_t bundleSize = BUNDLE_HEADER_SIZE;
+    size_t bundleElementCount = 0;
+    Clock::time_point bundleStarted;
+    std::atomic<bool> bundlingEnabled{false};
+    std::atomic<int64_t> bundleWindowUs{0};
+
+    void sendDatagram(const char* data, size_t size) {
+        socket.sendToAll(data, size);
+        if (OSCTcpStream* tcp = stream.load()) {
+            tcp->send(data, size);
+        }
+        datagramsSent++;
+    }
+
+    void flushBundle() {
+        if (bundleElementCount == 0) return;
+        if (bundleElementCount == 1) {
+            // A lone message goes out as a plain message, no bundle overhead
+            sendDatagram(bundleBuffer + BUNDLE_HEADER_SIZE + 4, bundleSize - BUNDLE_HEADER_SIZE - 4);
+        } else {
+            sendDatagram(bundleBuffer, bundleSize);
+            bundlesSent++;
+        }
+        bundleSize = BUNDLE_HEADER_SIZE;
+        bundleElementCount = 0;
+    }
+
+    void appendToBundle(const OSCPacket& packet) {
+        if (bundleSize + 4 + packet.size > MAX_BUNDLE_SIZE) {
+            flushBundle();
+        }
+        if (bundleElementCount == 0) {
+            bundleStarted = Clock::now();
+        }
+        OSCEncoding::writeUInt32BE(bundleBuffer + bundleSize, static_cast<uint32_t>(packet.size));
+        std::memcpy(bundleBuffer + bundleSize + 4, packet.data, packet.size);
+        bundleSize += 4 + packet.size;
+        bundleElementCount++;
+    }
+
+    enum class Wake { Packet, Flush, Stop };
+
+    // What an acquired permit stands for: a packet, a flush or shutdown. Queued packets go first,
+    // so a flush covers everything queued before it. The producer that owns the next slot may
+    // still be writing it, which only takes a few instructions, so yield until something shows.
+    Wake takeWake(QueuedPacket& queued) {
+        for (;;) {
+            if (sendQueue.tryPop(queued)) return Wake::Packet;
+            if (flushRequested.exchange(false)) return Wake::Flush;
+            if (shouldStop.load()) return Wake::Stop;
+            std::this_thread::yield();
+        }
+    }
+
+    // Dropped presses are worth a console line, but from here rather than from the producers,
+    // and at most once per interval
+    void reportDrops() {
+        uint64_t dropped = droppedImmediate.load();
+        if (dropped == reportedImmediate) return;
+        auto now = Clock::now();
+        if (now - lastDropReport < std::chrono::milliseconds(DROP_REPORT_INTERVAL_MS)) return;
+        std::cerr << "OSC: send queue full, dropped " << (dropped - reportedImmediate) << " immediate messages" << std::endl;
+        reportedImmediate = dropped;
+        lastDropReport = now;
+    }
+
+    void senderLoop() {
+        QueuedPacket queued;
+        for (;;) {
+            int64_t windowUs = bundleWindowUs.load();
+            if (bundleElementCount > 0 && windowUs > 0) {
+                // Wait for more packets, but no longer than the bundle window
+                auto deadline = bundleStarted + std::chrono::microseconds(windowUs);
+                if (!queuedCount.try_acquire_until(deadline)) {
+                    flushBundle();
+                    continue;
+                }
+            } else {
+                queuedCount.acquire();
+            }
+
+            Wake wake = takeWake(queued);
+            reportDrops();
+            if (wake == Wake::Flush) {
+                // LED frame or trailing continuous value
+                flushBundle();
+                continue;
+            }
+            if (wake == Wake::Stop) {
+                // Send what is already queued, but never wait for producers still running
+                while (sendQueue.tryPop(queued)) {
+                    sendQueued(queued);
+                }
+                flushBundle();
+                break;
+            }
+            sendQueued(queued);
+        }
+    }
+
+    void sendQueued(const QueuedPacket& queued) {
+        uint64_t delay = elapsedNs(queued.enqueued);
+        totalQueueDelayNs += delay;
+        updateMax(maxQueueDelayNs, delay);
+
+        if (!bundlingEnabled.load()) {
+            sendDatagram(queued.packet.data, queued.packet.size);
+            return;
+        }
+
+        appendToBundle(queued.packet);
+        if (queued.urgency == OSCUrgency::Immediate) {
+            flushBundle();
+        }
+    }
+
+    bool enqueue(const QueuedPacket& queued) {
+        bool immediate = queued.urgency == OSCUrgency::Immediate;
+        if ((!immediate && sendQueue.sizeApprox() >= QUEUE_CAPACITY - IMMEDIATE_RESERVE) || !sendQueue.tryPush(queued)) {
+            droppedPackets++;
+            if (immediate) droppedImmediate++;
+            return false;
+        }
+        queuedCount.release();
+        return true;
+    }
+
+    // A full queue drops the packet; drops are counted for oscstats, and dropped immediate ones
+    // reported by the sender thread, so producers never wait on the console
+    void transmit(const OSCPacket& packet, OSCUrgency urgency) {
+        QueuedPacket queued;
+        queued.packet = packet;
+        queued.urgency = urgency;
+        queued.enqueued = Clock::now();
+        enqueue(queued);
+    }
+
+    void sendEncoded(const OSCPacket& packet, bool encoded, OSCUrgency urgency, Clock::time_point start) {
+        if (!encoded) {
+            encodeErrors++;
+            std::cerr << "OSC: failed to encode message" << std::endl;
+            return;
+        }
+        transmit(packet, urgency);
+        recordSendTime(start);
+    }
+
 public:
-    OSCSender(const std::string& address, int port) 
-        : socket(IpEndpointName(address.c_str(), port)), 
-          remoteEndpoint(address.c_str(), port) {}
-    
-    void sendMessage(const std::string& address, float value) {
-        char buffer[1024];
-        osc::OutboundPacketStream p(buffer, 1024);
-        p << osc::BeginMessage(address.c_str()) << value << osc::EndMessage;
-        socket.Send(p.Data(), p.Size());
+    // No destinations yet; add UDP destinations or a TCP stream before sending
+    OSCSender() {
+        std::memcpy(bundleBuffer, "#bundle\0", 8);
+        OSCEncoding::writeUInt32BE(bundleBuffer + 8, 0);
+        OSCEncoding::writeUInt32BE(bundleBuffer + 12, 1); // time tag 1 = apply immediately
+        senderThread = std::thread(&OSCSender::senderLoop, this);
+    }
+
+    OSCSender(const std::string& address, int port) : OSCSender() {
+        addDestination(address, port);
+    }
+
+    ~OSCSender() {
+        // Everything queued before this point is still sent
+        shouldStop.store(true);
+        queuedCount.release();
+        if (senderThread.joinable()) {
+            senderThread.join();
+        }
+    }
+
+    OSCSender(const OSCSender&) = delete;
+    OSCSender& operator=(const OSCSender&) = delete;
+
+    // Mirror every outgoing packet to another host as well
+    bool addDestination(const std::string& address, int port) {
+        std::string name = address + ":" + std::to_string(port);
+        if (socket.addDestination(IpEndpointName(address.c_str(), port), name) < 0) {
+            std::cerr << "OSC: too many destinations, ignoring " << name << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Send every packet over an OSC-over-TCP stream as well (SLIP framed); nullptr to detach.
+    // The stream must outlive the sender or be detached first.
+    void setStream(OSCTcpStream* tcpStream) {
+        stream.store(tcpStream);
+    }
+
+    // Collect deferred messages into OSC bundles. With a zero window the bundle is sent on flush()
+    // (after each LED frame and after trailing continuous values), otherwise at most `window` after
+    // its first message.
+    void enableBundling(std::chrono::microseconds window) {
+        bundleWindowUs.store(window.count());
+        bundlingEnabled.store(true);
+    }
+
+    bool isBundlingEnabled() const { return bundlingEnabled.load(); }
+
+    // Send any pending bundle now
+    void flush() {
+        if (!bundlingEnabled.load()) return;
+        // One permit however many flushes pile up before the sender gets to it
+        if (!flushRequested.exchange(true)) {
+            queuedCount.release();
+        }
+    }
+
+    // Send a packet that was encoded (or patched) by the caller
+    void send(const OSCPacket& packet, OSCUrgency urgency = OSCUrgency::Immediate) {
+        auto start = Clock::now();
+        transmit(packet, urgency);
+        recordSendTime(start);
+    }
+
+    void sendMessage(const std::string& address, float value, OSCUrgency urgency = OSCUrgency::Immediate) {
+        auto start = Clock::now();
+        OSCPacket packet;
+        bool encoded = packet.setAddress(address.c_str(), address.size()) && packet.setFloat(value);
+        sendEncoded(packet, encoded, urgency, start);
         #ifdef DEBUG_OSC
         std::cout << "OSC: " << address << " " << value << std::endl;
         #endif
     }
-    
-    void sendMessage(const std::string& address, int value) {
-        char buffer[1024];
-        osc::OutboundPacketStream p(buffer, 1024);
-        p << osc::BeginMessage(address.c_str()) << value << osc::EndMessage;
-        socket.Send(p.Data(), p.Size());
+
+    void sendMessage(const std::string& address, int value, OSCUrgency urgency = OSCUrgency::Immediate) {
+        auto start = Clock::now();
+        OSCPacket packet;
+        bool encoded = packet.setAddress(address.c_str(), address.size()) && packet.setInt(value);
+        sendEncoded(packet, encoded, urgency, start);
         #ifdef DEBUG_OSC
         std::cout << "OSC: " << address << " " << value << std::endl;
         #endif
     }
-    
-    void sendMessage(const std::string& address, const std::string& value) {
-        char buffer[1024];
-        osc::OutboundPacketStream p(buffer, 1024);
-        p << osc::BeginMessage(address.c_str()) << value.c_str() << osc::EndMessage;
-        socket.Send(p.Data(), p.Size());
+
+    void sendMessage(const std::string& address, const std::string& value, OSCUrgency urgency = OSCUrgency::Immediate) {
+        auto start = Clock::now();
+        OSCPacket packet;
+        bool encoded = packet.setAddress(address.c_str(), address.size()) && packet.setString(value.c_str(), value.size());
+        sendEncoded(packet, encoded, urgency, start);
         #ifdef DEBUG_OSC
         std::cout << "OSC: " << address << " " << value << std::endl;
         #endif
     }
-};
\ No newline at end of file
+
+    // Templated addresses: indices are formatted straight into the packet, no heap allocation
+    void sendMessage(const OSCAddressTemplate& address, std::initializer_list<int> indices, int value, OSCUrgency urgency = OSCUrgency::Immediate) {
+        auto start = Clock::now();
+        OSCPacket packet;
+        bool encoded = packet.setAddress(address, indices) && packet.setInt(value);
+        sendEncoded(packet, encoded, urgency, start);
+        #ifdef DEBUG_OSC
+        std::cout << "OSC: " << address.toString(indices) << " " << value << std::endl;
+        #endif
+    }
+
+    void sendMessage(const OSCAddressTemplate& address, std::initializer_list<int> indices, float value, OSCUrgency urgency = OSCUrgency::Immediate) {
+        auto start = Clock::now();
+        OSCPacket packet;
+        bool encoded = packet.setAddress(address, indices) && packet.setFloat(value);
+        sendEncoded(packet, encoded, urgency, start);
+        #ifdef DEBUG_OSC
+        std::cout << "OSC: " << address.toString(indices) << " " << value << std::endl;
+        #endif
+    }
+
+    OSCSenderStats getStats() const {
+        OSCSenderStats stats;
+        stats.messagesSent = messagesSent.load();
+        stats.datagramsSent = datagramsSent.load();
+        stats.bundlesSent = bundlesSent.load();
+        stats.encodeErrors = encodeErrors.load();
+        stats.droppedPackets = droppedPackets.load();
+        stats.droppedImmediate = droppedImmediate.load();
+        stats.totalQueueDelayNs = totalQueueDelayNs.load();
+        stats.maxQueueDelayNs = maxQueueDelayNs.load();
+        stats.totalSendNs = totalSendNs.load();
+        stats.maxSendNs = maxSendNs.load();
+        stats.lastSendNs = lastSendNs.load();
+        return stats;
+    }
+
+    void printStats() const {
+        OSCSenderStats stats = getStats();
+        std::cout << "OSC sender: " << stats.messagesSent << " messages in " << stats.datagramsSent << " datagrams ("
+                  << stats.bundlesSent << " bundles), " << stats.encodeErrors << " encode errors, "
+                  << stats.droppedPackets << " dropped (" << stats.droppedImmediate << " immediate)" << std::endl;
+        if (stats.messagesSent > 0) {
+            std::cout << "  encode+enqueue ns: last " << stats.lastSendNs
+                      << ", avg " << stats.totalSendNs / stats.messagesSent
+                      << ", max " << stats.maxSendNs << std::endl;
+            std::cout << "  queue delay ns: avg " << stats.totalQueueDelayNs / stats.messagesSent
+                      << ", max " << stats.maxQueueDelayNs << std::endl;
+        }
+        for (const auto& destination : socket.getStats()) {
+            std::cout << "  -> " << destination.name << ": " << destination.packetsSent << " sent, "
+                      << destination.errors << " errors"
+                      << (destination.healthy() ? "" : " (failing, last error " + std::to_string(destination.lastError) + ")")
+                      << std::endl;
+        }
+        if (OSCTcpStream* tcp = stream.load()) {
+            OSCTcpStats tcpStats = tcp->getStats();
+            std::cout << "  -> tcp " << (tcpStats.connected ? tcpStats.peer : std::string("(not connected)")) << ": "
+                      << tcpStats.packetsSent << " sent, " << tcpStats.packetsReceived << " received, "
+                      << tcpStats.sendErrors << " send errors, " << tcpStats.droppedPackets << " dropped, " << tcpStats.framingErrors << " framing errors, "
+                      << tcpStats.oversizedPackets << " oversized, " << tcpStats.connects << " connects" << std::endl;
+        }
+    }
+};
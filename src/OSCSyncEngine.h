@@ -0,0 +1,376 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <iostream>
+#include <functional>
+#include <map>
+#include <cstdint>
+
+#include "OSCListener.h"
+
+// Range of the composition to sync, 1-based and inclusive
+struct OSCSyncWindow {
+    int firstLayer = 1;
+    int lastLayer = 9;
+    int firstColumn = 1;
+    int lastColumn = 9;
+};
+
+// How one sync request fared, handed to the completion handler
+struct OSCSyncRequestResult {
+    uint64_t id = 0;
+    std::string reason;
+    size_t answered = 0;
+    size_t unanswered = 0;
+    std::vector<uint64_t> covers;   // this id plus the requests a full resync took over
+};
+
+// Pulls the state the Push needs from Resolume instead of waiting for it to be sent.
+// Issues "?" queries for every parameter in a window, paced by a token bucket so neither
+// Resolume nor our receive buffer gets flooded. Replies flow through the normal listener queue
+// into the tracker; the engine only watches addresses go by, and re-queries the ones that
+// stayed silent. A sync is complete when everything answered or ran out of retries.
+class OSCSyncEngine {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int RETRY_TIMEOUT_MS = 250;
+    static constexpr int MAX_ATTEMPTS = 3;
+
+private:
+    struct Entry {
+        Clock::time_point sentAt;
+        int attempts = 0;
+        bool answered = false;
+        bool gaveUp = false;
+        uint64_t request = 0;   // the request that queried it
+    };
+
+    ResolumeOSCListener& listener;
+
+    std::mutex syncMutex;
+    std::condition_variable syncCondition;
+    std::thread syncThread;
+    bool shouldStop = false;
+
+    std::unordered_map<std::string, Entry> entries; // everything queried since the last full resync
+    std::deque<std::string> toSend;
+    std::atomic<bool> syncing{false};
+    // Called on the sync thread when a sync finishes, with every request it answered for
+    std::function<void(const std::vector<OSCSyncRequestResult>&)> completionHandler;
+
+    std::atomic<uint64_t> nextRequestId{1};
+    std::map<uint64_t, OSCSyncRequestResult> openRequests;
+
+    // Token bucket
+    double queriesPerSecond;
+    double burst;
+    double tokens;
+    Clock::time_point lastRefill;
+
+    // Current sync
+    Clock::time_point syncStarted;
+    std::string syncReason;
+    uint64_t syncQueries = 0;
+    uint64_t syncRetries = 0;
+
+    // Statistics
+    uint64_t totalQueries = 0;
+    uint64_t syncsCompleted = 0;
+    double lastSyncMs = 0.0;
+    size_t lastAnswered = 0;
+    size_t lastUnanswered = 0;
+
+    // Caller must hold syncMutex; returns how long to wait for the next token
+    Clock::duration takeToken(Clock::time_point now) {
+        double elapsed = std::chrono::duration<double>(now - lastRefill).count();
+        lastRefill = now;
+        tokens = std::min(burst, tokens + elapsed * queriesPerSecond);
+        if (tokens >= 1.0) {
+            tokens -= 1.0;
+            return Clock::duration::zero();
+        }
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>((1.0 - tokens) / queriesPerSecond));
+    }
+
+    static void addClipAddresses(std::vector<std::string>& addresses, int layer, int column) {
+        std::string clip = "/composition/layers/" + std::to_string(layer) + "/clips/" + std::to_string(column) + "/";
+        addresses.push_back(clip + "name");
+        addresses.push_back(clip + "connect");
+        addresses.push_back(clip + "transport/position");
+    }
+
+    static void addLayerAddresses(std::vector<std::string>& addresses, int layer) {
+        std::string prefix = "/composition/layers/" + std::to_string(layer) + "/";
+        addresses.push_back(prefix + "name");
+        addresses.push_back(prefix + "video/opacity");
+        addresses.push_back(prefix + "bypassed");
+        addresses.push_back(prefix + "crossfadergroup");
+    }
+
+    // Visible clips first, so the grid fills in before the layer details
+    static std::vector<std::string> addressesFor(const OSCSyncWindow& window) {
+        std::vector<std::string> addresses;
+        for (int layer = std::max(1, window.firstLayer); layer <= window.lastLayer; ++layer) {
+            for (int column = std::max(1, window.firstColumn); column <= window.lastColumn; ++column) {
+                addClipAddresses(addresses, layer, column);
+            }
+        }
+        for (int layer = std::max(1, window.firstLayer); layer <= window.lastLayer; ++layer) {
+            addLayerAddresses(addresses, layer);
+        }
+        for (int column = std::max(1, window.firstColumn); column <= window.lastColumn; ++column) {
+            addresses.push_back("/composition/columns/" + std::to_string(column) + "/connect");
+        }
+        return addresses;
+    }
+
+    // Caller holds syncMutex through lock; it is released while the completion handler runs
+    void finishSync(Clock::time_point now, std::unique_lock<std::mutex>& lock) {
+        size_t answered = 0, unanswered = 0;
+        for (const auto& [address, entry] : entries) {
+            if (entry.answered) answered++;
+            else if (entry.gaveUp) unanswered++;
+        }
+        lastSyncMs = std::chrono::duration<double, std::milli>(now - syncStarted).count();
+        lastAnswered = answered;
+        lastUnanswered = unanswered;
+        syncsCompleted++;
+
+        std::vector<OSCSyncRequestResult> results;
+        for (auto& [id, result] : openRequests) {
+            for (const auto& [address, entry] : entries) {
+                if (entry.request != id) continue;
+                if (entry.answered) result.answered++;
+                else if (entry.gaveUp) result.unanswered++;
+            }
+            results.push_back(std::move(result));
+        }
+        openRequests.clear();
+
+        syncing.store(false);
+        std::cout << "State sync (" << syncReason << ") complete in " << static_cast<int>(lastSyncMs) << " ms: "
+                  << answered << " answered, " << unanswered << " unanswered, " << syncQueries << " queries, "
+                  << syncRetries << " retries" << std::endl;
+        // The handler is user code and may call back into the engine or take other locks
+        auto handler = completionHandler;
+        if (handler) {
+            lock.unlock();
+            handler(results);
+            lock.lock();
+        }
+    }
+
+    void syncLoop() {
+        std::unique_lock<std::mutex> lock(syncMutex);
+        while (!shouldStop) {
+            if (!syncing.load()) {
+                syncCondition.wait(lock);
+                continue;
+            }
+
+            auto now = Clock::now();
+
+            // Send phase: one query per token
+            if (!toSend.empty()) {
+                Clock::duration wait = takeToken(now);
+                if (wait > Clock::duration::zero()) {
+                    syncCondition.wait_for(lock, wait);
+                    continue;
+                }
+                std::string address = std::move(toSend.front());
+                toSend.pop_front();
+                auto it = entries.find(address);
+                if (it == entries.end() || it->second.answered) {
+                    tokens += 1.0; // nothing sent, give the token back
+                    continue;
+                }
+                it->second.attempts++;
+                it->second.sentAt = now;
+                syncQueries++;
+                totalQueries++;
+
+                lock.unlock();
+                try {
+                    listener.QueryNoResponse(address);
+                } catch (const std::exception& e) {
+                    std::cerr << "State sync: " << e.what() << std::endl;
+                }
+                lock.lock();
+                continue;
+            }
+
+            // Wait phase: re-queue silent addresses once their reply is overdue
+            bool outstanding = false;
+            auto nextDeadline = Clock::time_point::max();
+            for (auto& [address, entry] : entries) {
+                if (entry.answered || entry.gaveUp || entry.attempts == 0) continue;
+                auto deadline = entry.sentAt + std::chrono::milliseconds(RETRY_TIMEOUT_MS);
+                if (now < deadline) {
+                    outstanding = true;
+                    nextDeadline = std::min(nextDeadline, deadline);
+                } else if (entry.attempts < MAX_ATTEMPTS) {
+                    toSend.push_back(address);
+                    syncRetries++;
+                } else {
+                    entry.gaveUp = true;
+                }
+            }
+            if (!toSend.empty()) continue;
+            if (!outstanding) {
+                finishSync(now, lock);
+                continue;
+            }
+            syncCondition.wait_until(lock, nextDeadline);
+        }
+    }
+
+public:
+    OSCSyncEngine(ResolumeOSCListener& oscListener, double maxQueriesPerSecond = 500.0, double maxBurst = 20.0)
+        : listener(oscListener), queriesPerSecond(maxQueriesPerSecond), burst(maxBurst), tokens(maxBurst),
+          lastRefill(Clock::now()) {
+        syncThread = std::thread(&OSCSyncEngine::syncLoop, this);
+    }
+
+    ~OSCSyncEngine() {
+        {
+            std::lock_guard<std::mutex> lock(syncMutex);
+            shouldStop = true;
+        }
+        syncCondition.notify_all();
+        if (syncThread.joinable()) {
+            syncThread.join();
+        }
+    }
+
+    OSCSyncEngine(const OSCSyncEngine&) = delete;
+    OSCSyncEngine& operator=(const OSCSyncEngine&) = delete;
+
+    void setRate(double maxQueriesPerSecond) {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        if (maxQueriesPerSecond > 0.0) queriesPerSecond = maxQueriesPerSecond;
+    }
+
+    // Query everything in the window that hasn't answered yet. With fullResync all earlier answers
+    // are forgotten first (startup, deck change). Returns the request id, 0 if nothing needed asking.
+    uint64_t requestSync(const OSCSyncWindow& window, bool fullResync, const std::string& reason) {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        return requestAddresses(addressesFor(window), fullResync, reason, 0, {});
+    }
+
+    // Set before the first sync is requested
+    void setCompletionHandler(std::function<void(const std::vector<OSCSyncRequestResult>&)> handler) {
+        completionHandler = std::move(handler);
+    }
+
+    // An id to pass to requery(), for callers that must record it before the request can complete
+    uint64_t reserveRequestId() { return nextRequestId++; }
+
+    // Query everything in the window again, answered or not
+    uint64_t requeryWindow(const OSCSyncWindow& window, const std::string& reason, uint64_t id = 0) {
+        return requery(addressesFor(window), reason, id);
+    }
+
+    // Query specific addresses again even if they answered before (e.g. after packet loss)
+    uint64_t requery(const std::vector<std::string>& addresses, const std::string& reason, uint64_t id = 0) {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        std::unordered_set<std::string> requeried(addresses.begin(), addresses.end());
+        std::unordered_set<uint64_t> previous;
+        for (const auto& address : addresses) {
+            auto it = entries.find(address);
+            if (it == entries.end()) continue;
+            if (openRequests.count(it->second.request) > 0) previous.insert(it->second.request);
+            entries.erase(it);
+        }
+        toSend.erase(std::remove_if(toSend.begin(), toSend.end(),
+            [&requeried](const std::string& address) { return requeried.count(address) > 0; }), toSend.end());
+
+        // An open request with nothing of its own left is answered for by this one
+        std::vector<uint64_t> takenOver;
+        for (uint64_t previousId : previous) {
+            bool remaining = std::any_of(entries.begin(), entries.end(),
+                [previousId](const auto& item) { return item.second.request == previousId; });
+            if (!remaining) takenOver.push_back(previousId);
+        }
+        return requestAddresses(addresses, false, reason, id, takenOver);
+    }
+
+    // Called by the listener for every received message
+    void noteMessage(const std::string& address) {
+        if (!syncing.load(std::memory_order_relaxed)) return;
+        std::lock_guard<std::mutex> lock(syncMutex);
+        auto it = entries.find(address);
+        if (it == entries.end() || it->second.answered) return;
+        it->second.answered = true;
+        syncCondition.notify_one();
+    }
+
+    bool isSyncing() const { return syncing.load(); }
+
+    void printStats() {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        std::cout << "State sync: " << (syncing.load() ? "in progress, " : "idle, ") << syncsCompleted << " completed, "
+                  << totalQueries << " queries total, pacing " << queriesPerSecond << "/s" << std::endl;
+        if (syncsCompleted > 0) {
+            std::cout << "  last sync: " << static_cast<int>(lastSyncMs) << " ms, " << lastAnswered << " answered, "
+                      << lastUnanswered << " unanswered" << std::endl;
+        }
+    }
+
+private:
+    // Caller must hold syncMutex. takenOver: open requests this one answers for.
+    uint64_t requestAddresses(const std::vector<std::string>& addresses, bool fullResync, const std::string& reason,
+                              uint64_t id, const std::vector<uint64_t>& takenOver) {
+        if (id == 0) id = nextRequestId++;
+        OSCSyncRequestResult request;
+        request.id = id;
+        request.reason = reason;
+        request.covers.push_back(id);
+        for (uint64_t previousId : takenOver) {
+            auto it = openRequests.find(previousId);
+            if (it == openRequests.end()) continue;
+            request.covers.insert(request.covers.end(), it->second.covers.begin(), it->second.covers.end());
+            openRequests.erase(it);
+        }
+        if (fullResync) {
+            // Earlier requests lose their entries; this one answers for them
+            for (auto& [openId, open] : openRequests) {
+                request.covers.insert(request.covers.end(), open.covers.begin(), open.covers.end());
+            }
+            openRequests.clear();
+            entries.clear();
+            toSend.clear();
+        }
+        size_t queued = 0;
+        for (const auto& address : addresses) {
+            auto [it, inserted] = entries.try_emplace(address);
+            if (!inserted && (it->second.answered || (it->second.attempts > 0 && !it->second.gaveUp))) continue; // known or in flight
+            it->second = Entry{};
+            it->second.request = id;
+            toSend.push_back(address);
+            queued++;
+        }
+        if (queued == 0 && request.covers.size() == 1) return 0;
+        openRequests[id] = std::move(request);
+        if (toSend.empty()) return id;
+        if (!syncing.load() || fullResync) {
+            syncStarted = Clock::now();
+            syncReason = reason;
+            syncQueries = 0;
+            syncRetries = 0;
+        }
+        syncing.store(true);
+        syncCondition.notify_one();
+        return id;
+    }
+};
@@ -0,0 +1,535 @@
+#include "OSCTcpStream.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>   // this must come first to prevent errors with MSVC7
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ip/NetworkingUtils.h"
+#include "ip/IpEndpointName.h"
+#include "SlipCodec.h"
+
+#if defined(_WIN32)
+typedef SOCKET NativeSocket;
+static const NativeSocket INVALID_NATIVE_SOCKET = INVALID_SOCKET;
+static void closeNativeSocket(NativeSocket s) { closesocket(s); }
+static void shutdownNativeSocket(NativeSocket s) { shutdown(s, SD_BOTH); }
+static bool connectInProgress() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static bool wouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static const int SEND_FLAGS = 0;
+typedef int SockLen;
+#else
+typedef int NativeSocket;
+static const NativeSocket INVALID_NATIVE_SOCKET = -1;
+static void closeNativeSocket(NativeSocket s) { close(s); }
+static void shutdownNativeSocket(NativeSocket s) { shutdown(s, SHUT_RDWR); }
+static bool connectInProgress() { return errno == EINPROGRESS; }
+static bool wouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+#if defined(MSG_NOSIGNAL)
+static const int SEND_FLAGS = MSG_NOSIGNAL; // a dropped peer must not kill us with SIGPIPE
+#else
+static const int SEND_FLAGS = 0;
+#endif
+typedef socklen_t SockLen;
+#endif
+
+static void sockaddrFromEndpoint(struct sockaddr_in& sockAddr, const IpEndpointName& endpoint) {
+    std::memset(&sockAddr, 0, sizeof(sockAddr));
+    sockAddr.sin_family = AF_INET;
+    sockAddr.sin_addr.s_addr = (endpoint.address == IpEndpointName::ANY_ADDRESS) ? INADDR_ANY : htonl(endpoint.address);
+    sockAddr.sin_port = htons(static_cast<unsigned short>(endpoint.port));
+}
+
+static IpEndpointName endpointFromSockaddr(const struct sockaddr_in& sockAddr) {
+    return IpEndpointName(ntohl(sockAddr.sin_addr.s_addr), ntohs(sockAddr.sin_port));
+}
+
+// Wait until the socket is readable, at most timeoutMs; returns false on timeout
+static bool waitReadable(NativeSocket socket, int timeoutMs) {
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(socket, &readSet);
+    struct timeval timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+    return select(static_cast<int>(socket) + 1, &readSet, nullptr, nullptr, &timeout) > 0;
+}
+
+// Wait until the socket is writable or has failed (how Windows reports a refused connect),
+// at most timeoutMs; returns false on timeout
+static bool waitWritable(NativeSocket socket, int timeoutMs) {
+    fd_set writeSet, exceptSet;
+    FD_ZERO(&writeSet);
+    FD_ZERO(&exceptSet);
+    FD_SET(socket, &writeSet);
+    FD_SET(socket, &exceptSet);
+    struct timeval timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+    return select(static_cast<int>(socket) + 1, nullptr, &writeSet, &exceptSet, &timeout) > 0;
+}
+
+static bool setNonBlocking(NativeSocket socket, bool nonBlocking) {
+#if defined(_WIN32)
+    u_long mode = nonBlocking ? 1 : 0;
+    return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags < 0) return false;
+    return fcntl(socket, F_SETFL, nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK)) == 0;
+#endif
+}
+
+class OSCTcpStream::Implementation {
+public:
+    static constexpr int POLL_MS = 100;              // how quickly stop() is noticed
+    static constexpr int RECONNECT_DELAY_MS = 1000;
+    static constexpr int CONNECT_TIMEOUT_MS = 3000;
+    static constexpr int STALL_TIMEOUT_MS = 5000;    // a peer that stops reading is dropped after this
+    static constexpr size_t OUTBOX_SIZE = 1 << 20;   // bytes of encoded frames waiting for the writer
+    static constexpr size_t WRITE_CHUNK = 16384;
+
+    NetworkInitializer networkInitializer_;
+    PacketListener* listener_;
+    SlipDecoder decoder_{MAX_PACKET_SIZE};
+
+    std::thread thread_;
+    std::thread writerThread_;
+    std::atomic<bool> shouldStop_{false};
+
+    bool listening_ = false;
+    IpEndpointName remote_;
+    NativeSocket listenSocket_ = INVALID_NATIVE_SOCKET;
+
+    // The connected peer; guarded by sendMutex_ so the writer never writes to a closed socket
+    mutable std::mutex sendMutex_;
+    NativeSocket peerSocket_ = INVALID_NATIVE_SOCKET;
+    bool peerDropped_ = false;  // shut down by the writer, waiting for serve() to notice
+    IpEndpointName peerEndpoint_;
+
+    // Encoded frames for the writer thread, a byte ring, so send() never waits on the socket.
+    // Only whole frames go in; a frame that doesn't fit is dropped.
+    std::mutex outboxMutex_;
+    std::condition_variable outboxCondition_;
+    std::unique_ptr<char[]> encodeBuffer_{new char[Slip::maxEncodedSize(MAX_PACKET_SIZE)]};
+    std::unique_ptr<char[]> outbox_{new char[OUTBOX_SIZE]};
+    size_t outboxHead_ = 0;     // next byte to fill
+    size_t outboxTail_ = 0;     // next byte for the writer
+    size_t outboxUsed_ = 0;
+    // Bumped when the connection goes away: whatever the writer still holds belongs to the old peer
+    std::atomic<uint64_t> outboxGeneration_{0};
+
+    std::atomic<uint64_t> connects_{0};
+    std::atomic<uint64_t> packetsReceived_{0};
+    std::atomic<uint64_t> packetsSent_{0};
+    std::atomic<uint64_t> bytesReceived_{0};
+    std::atomic<uint64_t> bytesSent_{0};
+    std::atomic<uint64_t> sendErrors_{0};
+    std::atomic<uint64_t> droppedPackets_{0};
+    std::atomic<uint64_t> oversizedPackets_{0};  // mirrored from the decoder for getStats()
+    std::atomic<uint64_t> framingErrors_{0};
+
+    explicit Implementation(PacketListener* listener) : listener_(listener) {}
+
+    ~Implementation() {
+        stop();
+    }
+
+    void start() {
+        shouldStop_.store(false);
+        thread_ = std::thread(&Implementation::run, this);
+        writerThread_ = std::thread(&Implementation::writeLoop, this);
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(outboxMutex_);
+            shouldStop_.store(true);
+        }
+        outboxCondition_.notify_all();
+        if (writerThread_.joinable()) {
+            writerThread_.join();
+        }
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        if (listenSocket_ != INVALID_NATIVE_SOCKET) {
+            closeNativeSocket(listenSocket_);
+            listenSocket_ = INVALID_NATIVE_SOCKET;
+        }
+    }
+
+    void sleepInterruptible(int ms) {
+        for (int waited = 0; waited < ms && !shouldStop_.load(); waited += POLL_MS) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MS));
+        }
+    }
+
+    // Non-blocking connect, so an unreachable host never holds up stop()
+    NativeSocket connectToRemote() {
+        NativeSocket s = socket(AF_INET, SOCK_STREAM, 0);
+        if (s == INVALID_NATIVE_SOCKET) return s;
+        struct sockaddr_in address;
+        sockaddrFromEndpoint(address, remote_);
+        if (!setNonBlocking(s, true)) {
+            closeNativeSocket(s);
+            return INVALID_NATIVE_SOCKET;
+        }
+
+        bool connected = ::connect(s, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0;
+        if (!connected && connectInProgress()) {
+            for (int waited = 0; waited < CONNECT_TIMEOUT_MS && !shouldStop_.load(); waited += POLL_MS) {
+                if (!waitWritable(s, POLL_MS)) continue;
+                int error = 0;
+                SockLen errorLength = sizeof(error);
+                connected = getsockopt(s, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &errorLength) == 0 && error == 0;
+                break;
+            }
+        }
+        if (!connected || !setNonBlocking(s, false)) {
+            closeNativeSocket(s);
+            return INVALID_NATIVE_SOCKET;
+        }
+        return s;
+    }
+
+    NativeSocket acceptPeer(IpEndpointName& peer) {
+        if (!waitReadable(listenSocket_, POLL_MS)) return INVALID_NATIVE_SOCKET;
+        struct sockaddr_in address;
+        SockLen addressLength = sizeof(address);
+        NativeSocket s = accept(listenSocket_, reinterpret_cast<struct sockaddr*>(&address), &addressLength);
+        if (s != INVALID_NATIVE_SOCKET) peer = endpointFromSockaddr(address);
+        return s;
+    }
+
+    // Read and decode until the peer goes away or stop() is called
+    void serve(NativeSocket s, const IpEndpointName& peer) {
+        int noDelay = 1; // control messages are tiny; don't let Nagle hold them back
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+        setNonBlocking(s, true); // the writer polls instead of blocking
+
+        {
+            std::lock_guard<std::mutex> lock(sendMutex_);
+            peerSocket_ = s;
+            peerDropped_ = false;
+            peerEndpoint_ = peer;
+        }
+        connects_++;
+        decoder_.reset();
+
+        char buffer[4096];
+        while (!shouldStop_.load()) {
+            if (!waitReadable(s, POLL_MS)) continue;
+            int received = recv(s, buffer, sizeof(buffer), 0);
+            if (received < 0 && wouldBlock()) continue;
+            if (received <= 0) break;
+            bytesReceived_ += received;
+            decoder_.feed(buffer, static_cast<size_t>(received), [this, &peer](const char* data, size_t size) {
+                packetsReceived_++;
+                if (listener_) listener_->ProcessPacket(data, static_cast<int>(size), peer);
+            });
+            oversizedPackets_.store(decoder_.getOversizedPackets());
+            framingErrors_.store(decoder_.getFramingErrors());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(sendMutex_);
+            closeNativeSocket(peerSocket_);
+            peerSocket_ = INVALID_NATIVE_SOCKET;
+        }
+        clearOutbox();
+    }
+
+    void clearOutbox() {
+        std::lock_guard<std::mutex> lock(outboxMutex_);
+        outboxHead_ = outboxTail_ = outboxUsed_ = 0;
+        outboxGeneration_++;
+    }
+
+    // Drop the peer; serve() sees it and reconnects. What is queued for it goes too.
+    void dropPeer(NativeSocket s) {
+        {
+            std::lock_guard<std::mutex> lock(sendMutex_);
+            if (peerSocket_ != s || peerDropped_) return;
+            shutdownNativeSocket(s);
+            peerDropped_ = true;
+        }
+        sendErrors_++;
+        clearOutbox();
+    }
+
+    // Write one chunk taken from the outbox; false if it had to be given up
+    bool writeChunk(const char* data, size_t size, uint64_t generation) {
+        size_t offset = 0;
+        auto stalledSince = std::chrono::steady_clock::now();
+        while (offset < size && !shouldStop_.load()) {
+            NativeSocket s;
+            int written;
+            {
+                std::lock_guard<std::mutex> lock(sendMutex_);
+                s = peerSocket_;
+                if (s == INVALID_NATIVE_SOCKET || generation != outboxGeneration_.load()) return false;
+                written = ::send(s, data + offset, static_cast<int>(size - offset), SEND_FLAGS);
+            }
+            if (written > 0) {
+                offset += static_cast<size_t>(written);
+                bytesSent_ += static_cast<uint64_t>(written);
+                stalledSince = std::chrono::steady_clock::now();
+            } else if (written < 0 && wouldBlock()) {
+                if (std::chrono::steady_clock::now() - stalledSince > std::chrono::milliseconds(STALL_TIMEOUT_MS)) {
+                    dropPeer(s);
+                    return false;
+                }
+                waitWritable(s, POLL_MS);
+            } else {
+                dropPeer(s);
+                return false;
+            }
+        }
+        return offset == size;
+    }
+
+    // Writer thread: drains the outbox to the peer in chunks, off the caller's thread
+    void writeLoop() {
+        std::unique_ptr<char[]> chunk(new char[WRITE_CHUNK]);
+        for (;;) {
+            size_t size;
+            uint64_t generation;
+            {
+                std::unique_lock<std::mutex> lock(outboxMutex_);
+                outboxCondition_.wait(lock, [this]() { return shouldStop_.load() || outboxUsed_ > 0; });
+                if (shouldStop_.load()) return;
+                size = std::min({outboxUsed_, OUTBOX_SIZE - outboxTail_, WRITE_CHUNK});
+                std::memcpy(chunk.get(), outbox_.get() + outboxTail_, size);
+                outboxTail_ = (outboxTail_ + size) % OUTBOX_SIZE;
+                outboxUsed_ -= size;
+                generation = outboxGeneration_.load();
+            }
+            writeChunk(chunk.get(), size, generation);
+        }
+    }
+
+    void run() {
+        while (!shouldStop_.load()) {
+            IpEndpointName peer = remote_;
+            NativeSocket s = listening_ ? acceptPeer(peer) : connectToRemote();
+            if (s == INVALID_NATIVE_SOCKET) {
+                if (!listening_) sleepInterruptible(RECONNECT_DELAY_MS);
+                continue;
+            }
+            serve(s, peer);
+        }
+    }
+
+    // Encode into the outbox for the writer thread; never waits on the socket
+    bool send(const char* data, size_t size) {
+        if (size > MAX_PACKET_SIZE) {
+            sendErrors_++;
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(sendMutex_);
+            if (peerSocket_ == INVALID_NATIVE_SOCKET || peerDropped_) return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(outboxMutex_);
+            size_t length = Slip::encode(data, size, encodeBuffer_.get());
+            if (length > OUTBOX_SIZE - outboxUsed_) {
+                // The peer is not keeping up
+                droppedPackets_++;
+                return false;
+            }
+            size_t first = std::min(length, OUTBOX_SIZE - outboxHead_);
+            std::memcpy(outbox_.get() + outboxHead_, encodeBuffer_.get(), first);
+            std::memcpy(outbox_.get(), encodeBuffer_.get() + first, length - first);
+            outboxHead_ = (outboxHead_ + length) % OUTBOX_SIZE;
+            outboxUsed_ += length;
+        }
+        outboxCondition_.notify_one();
+        packetsSent_++;
+        return true;
+    }
+};
+
+OSCTcpStream::OSCTcpStream(PacketListener* listener) {
+    impl_ = new Implementation(listener);
+}
+
+OSCTcpStream::~OSCTcpStream() {
+    delete impl_;
+}
+
+void OSCTcpStream::connect(const std::string& host, int port) {
+    impl_->listening_ = false;
+    impl_->remote_ = IpEndpointName(host.c_str(), port);
+    impl_->start();
+}
+
+void OSCTcpStream::listen(int port) {
+    NativeSocket s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == INVALID_NATIVE_SOCKET) {
+        throw std::runtime_error("unable to create tcp socket\n");
+    }
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    struct sockaddr_in address;
+    sockaddrFromEndpoint(address, IpEndpointName(IpEndpointName::ANY_ADDRESS, port));
+    if (bind(s, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0 || ::listen(s, 1) < 0) {
+        closeNativeSocket(s);
+        throw std::runtime_error("unable to bind tcp socket\n");
+    }
+
+    impl_->listening_ = true;
+    impl_->listenSocket_ = s;
+    impl_->start();
+}
+
+void OSCTcpStream::stop() {
+    impl_->stop();
+}
+
+bool OSCTcpStream::isConnected() const {
+    std::lock_guard<std::mutex> lock(impl_->sendMutex_);
+    return impl_->peerSocket_ != INVALID_NATIVE_SOCKET;
+}
+
+bool OSCTcpStream::send(const char* data, size_t size) {
+    return impl_->send(data, size);
+}
+
+OSCTcpStats OSCTcpStream::getStats() const {
+    OSCTcpStats stats;
+    {
+        std::lock_guard<std::mutex> lock(impl_->sendMutex_);
+        stats.connected = impl_->peerSocket_ != INVALID_NATIVE_SOCKET;
+        if (stats.connected) {
+            char name[IpEndpointName::ADDRESS_AND_PORT_STRING_LENGTH];
+            impl_->peerEndpoint_.AddressAndPortAsString(name);
+            stats.peer = name;
+        }
+    }
+    stats.connects = impl_->connects_.load();
+    stats.packetsReceived = impl_->packetsReceived_.load();
+    stats.packetsSent = impl_->packetsSent_.load();
+    stats.bytesReceived = impl_->bytesReceived_.load();
+    stats.bytesSent = impl_->bytesSent_.load();
+    stats.sendErrors = impl_->sendErrors_.load();
+    stats.droppedPackets = impl_->droppedPackets_.load();
+    stats.oversizedPackets = impl_->oversizedPackets_.load();
+    stats.framingErrors = impl_->framingErrors_.load();
+    return stats;
+}
+
+namespace {
+
+// Collects what one end of the self test receives
+class CollectingListener : public PacketListener {
+public:
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<std::string> packets;
+
+    void ProcessPacket(const char* data, int size, const IpEndpointName&) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        packets.emplace_back(data, static_cast<size_t>(size));
+        condition.notify_all();
+    }
+
+    bool waitFor(size_t count, int timeoutMs) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this, count]() { return packets.size() >= count; });
+    }
+};
+
+bool waitConnected(const OSCTcpStream& stream, int timeoutMs) {
+    for (int waited = 0; waited < timeoutMs; waited += 10) {
+        if (stream.isConnected()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+// Sends every payload from one end and checks the other end gets them back byte for byte
+bool roundTrip(const char* direction, OSCTcpStream& from, CollectingListener& to, const std::vector<std::string>& payloads) {
+    for (const auto& payload : payloads) {
+        if (!from.send(payload.data(), payload.size())) {
+            std::cout << "  " << direction << ": send failed" << std::endl;
+            return false;
+        }
+    }
+    bool arrived = to.waitFor(payloads.size(), 2000);
+    std::lock_guard<std::mutex> lock(to.mutex);
+    bool pass = arrived && to.packets == payloads;
+    std::cout << "  " << direction << ": " << to.packets.size() << "/" << payloads.size() << " packets "
+              << (pass ? "ok" : "FAILED") << std::endl;
+    return pass;
+}
+
+} // namespace
+
+bool OSCTcpStream::selfTest(int port) {
+    const char END = static_cast<char>(0xC0);
+    const char ESC = static_cast<char>(0xDB);
+    const char ESC_END = static_cast<char>(0xDC);
+    const char ESC_ESC = static_cast<char>(0xDD);
+
+    const char message[] = "/composition/tempocontroller/tempo\0\0,f\0\0\x42\xC0\xDB\x00";
+    std::vector<std::string> payloads;
+    payloads.push_back(std::string(message, sizeof(message) - 1));
+    payloads.push_back(std::string(1, END));
+    payloads.push_back(std::string(1, ESC));
+    payloads.push_back(std::string{END, END, ESC, ESC, ESC_END, ESC_ESC, ESC, ESC_END, ESC, ESC_ESC, END});
+    payloads.push_back(std::string{'a', ESC, END, 'b', '\0', END, ESC});
+    std::string large(60000, '\0');
+    for (size_t i = 0; i < large.size(); ++i) {
+        large[i] = static_cast<char>(i % 7 == 0 ? END : i % 11 == 0 ? ESC : i & 0xFF);
+    }
+    payloads.push_back(large);
+
+    std::cout << "OSC TCP self test on 127.0.0.1:" << port << std::endl;
+    CollectingListener serverReceived, clientReceived;
+    OSCTcpStream server(&serverReceived);
+    OSCTcpStream client(&clientReceived);
+    try {
+        server.listen(port);
+    } catch (const std::exception& e) {
+        std::cout << "  listen: " << e.what();
+        return false;
+    }
+    client.connect("127.0.0.1", port);
+    if (!waitConnected(client, 3000) || !waitConnected(server, 3000)) {
+        std::cout << "  connect: FAILED" << std::endl;
+        return false;
+    }
+
+    bool pass = roundTrip("client -> server", client, serverReceived, payloads);
+    pass = roundTrip("server -> client", server, clientReceived, payloads) && pass;
+    client.stop();
+    server.stop();
+    std::cout << "OSC TCP self test " << (pass ? "passed" : "FAILED") << std::endl;
+    return pass;
+}
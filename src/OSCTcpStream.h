@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "ip/PacketListener.h"
+
+struct OSCTcpStats {
+    bool connected = false;
+    std::string peer;
+    uint64_t connects = 0;
+    uint64_t packetsReceived = 0;
+    uint64_t packetsSent = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t bytesSent = 0;
+    uint64_t sendErrors = 0;
+    uint64_t droppedPackets = 0;    // outbox full: the peer is not reading fast enough
+    uint64_t oversizedPackets = 0;
+    uint64_t framingErrors = 0;
+};
+
+// OSC 1.1 stream transport: OSC packets over TCP with SLIP framing.
+// Runs alongside the UDP socket. Received packets are decoded on the stream's own thread and
+// handed to the same PacketListener the UDP socket uses; send() frames a packet into a bounded
+// outbox that a writer thread drains to the current peer. Either connects out (and reconnects when the peer goes away) or
+// listens and serves one peer at a time.
+// Platform code lives in OSCTcpStream.cpp so socket headers don't leak into the rest of the tree.
+class OSCTcpStream {
+    class Implementation;
+    Implementation* impl_;
+
+public:
+    static constexpr size_t MAX_PACKET_SIZE = 65536;
+
+    explicit OSCTcpStream(PacketListener* listener);
+    ~OSCTcpStream();
+
+    OSCTcpStream(const OSCTcpStream&) = delete;
+    OSCTcpStream& operator=(const OSCTcpStream&) = delete;
+
+    // Start the stream thread; call one of these once
+    void connect(const std::string& host, int port);
+    void listen(int port);   // throws std::runtime_error if the port cannot be bound
+    void stop();
+
+    bool isConnected() const;
+
+    // Safe to call from any thread and never blocks on the socket; returns false if there is no
+    // peer or the outbox is full
+    bool send(const char* data, size_t size);
+
+    OSCTcpStats getStats() const;
+
+    // Loopback check: a listening and a connecting stream on 127.0.0.1:<port> exchange packets
+    // full of SLIP END/ESC bytes both ways. Prints the outcome; false if anything got lost or mangled.
+    static bool selfTest(int port);
+};
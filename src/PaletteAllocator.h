@@ -0,0 +1,270 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "PushPalette.h"
+#include "Color.h"
+
+// Hands out Push 2 palette indices for colours.
+// Every index has an RGB half (used by pads and RGB buttons) and a white half (used by BW buttons),
+// allocated independently. Each half maps colour -> index through a small open-addressed hash table,
+// counts how many LEDs currently show it, and keeps unreferenced indices in an LRU list so a colour
+// that comes back soon is still there, while the one unused the longest is recycled first.
+// All operations are O(1); nothing scans the palette.
+// The Push has 94 RGB and 90 BW LEDs, fewer than the free indices per half, so allocation
+// cannot run out while callers release what they no longer show.
+class PaletteAllocator {
+public:
+    static constexpr int SIZE = PushPalette::SIZE;
+
+private:
+    static constexpr uint32_t NO_KEY = 0xFFFFFFFF;
+
+    // key -> index, linear probing with backward-shift deletion; at most half full
+    class KeyTable {
+        static constexpr int BUCKETS = SIZE * 2;
+        uint32_t keys[BUCKETS];
+        int16_t slots[BUCKETS];
+
+        static int bucketFor(uint32_t key) {
+            return static_cast<int>((key * 2654435761u) >> 24) & (BUCKETS - 1);
+        }
+
+    public:
+        KeyTable() {
+            for (int i = 0; i < BUCKETS; ++i) {
+                keys[i] = NO_KEY;
+                slots[i] = -1;
+            }
+        }
+
+        int find(uint32_t key) const {
+            for (int b = bucketFor(key); keys[b] != NO_KEY; b = (b + 1) & (BUCKETS - 1)) {
+                if (keys[b] == key) return slots[b];
+            }
+            return -1;
+        }
+
+        void insert(uint32_t key, int slot) {
+            int b = bucketFor(key);
+            while (keys[b] != NO_KEY && keys[b] != key) b = (b + 1) & (BUCKETS - 1);
+            keys[b] = key;
+            slots[b] = static_cast<int16_t>(slot);
+        }
+
+        void erase(uint32_t key) {
+            int b = bucketFor(key);
+            while (keys[b] != key) {
+                if (keys[b] == NO_KEY) return;
+                b = (b + 1) & (BUCKETS - 1);
+            }
+            // Pull later members of the probe run back so find() never stops early
+            int hole = b;
+            for (int next = (hole + 1) & (BUCKETS - 1); keys[next] != NO_KEY; next = (next + 1) & (BUCKETS - 1)) {
+                int home = bucketFor(keys[next]);
+                bool movable = (hole <= next) ? (home <= hole || home > next) : (home <= hole && home > next);
+                if (movable) {
+                    keys[hole] = keys[next];
+                    slots[hole] = slots[next];
+                    hole = next;
+                }
+            }
+            keys[hole] = NO_KEY;
+            slots[hole] = -1;
+        }
+    };
+
+    // One half (RGB or white) of every palette entry
+    struct Channel {
+        uint32_t key[SIZE];
+        uint16_t refs[SIZE];
+        bool pinned[SIZE];
+        int16_t prev[SIZE], next[SIZE];   // LRU list of unreferenced indices, head = released longest ago
+        bool listed[SIZE];
+        int16_t head = -1, tail = -1;
+        KeyTable table;
+
+        uint64_t hits = 0, misses = 0, evictions = 0, exhausted = 0;
+
+        Channel() {
+            for (int i = 0; i < SIZE; ++i) {
+                key[i] = NO_KEY;
+                refs[i] = 0;
+                pinned[i] = false;
+                listed[i] = false;
+            }
+        }
+
+        void unlink(int slot) {
+            if (!listed[slot]) return;
+            if (prev[slot] >= 0) next[prev[slot]] = next[slot]; else head = next[slot];
+            if (next[slot] >= 0) prev[next[slot]] = prev[slot]; else tail = prev[slot];
+            listed[slot] = false;
+        }
+
+        void append(int slot) {
+            prev[slot] = tail;
+            next[slot] = -1;
+            if (tail >= 0) next[tail] = static_cast<int16_t>(slot); else head = static_cast<int16_t>(slot);
+            tail = static_cast<int16_t>(slot);
+            listed[slot] = true;
+        }
+
+        void pin(int slot, uint32_t colourKey) {
+            unlink(slot);
+            if (key[slot] != NO_KEY) table.erase(key[slot]);
+            pinned[slot] = true;
+            key[slot] = colourKey;
+            table.insert(colourKey, slot);
+        }
+
+        // Index for the key; claimed is set when an index was (re)assigned to it. -1 if none is free
+        int acquire(uint32_t colourKey, bool& claimed) {
+            claimed = false;
+            int slot = table.find(colourKey);
+            if (slot >= 0) {
+                hits++;
+                if (!pinned[slot]) {
+                    unlink(slot);
+                    refs[slot]++;
+                }
+                return slot;
+            }
+            misses++;
+            slot = head;
+            if (slot < 0) {
+                exhausted++;
+                return -1;
+            }
+            unlink(slot);
+            if (key[slot] != NO_KEY) {
+                table.erase(key[slot]);
+                evictions++;
+            }
+            key[slot] = colourKey;
+            table.insert(colourKey, slot);
+            refs[slot] = 1;
+            claimed = true;
+            return slot;
+        }
+
+        void release(int slot) {
+            if (slot < 0 || slot >= SIZE || pinned[slot] || refs[slot] == 0) return;
+            if (--refs[slot] == 0) append(slot); // keeps its colour until recycled
+        }
+
+        int inUse() const {
+            int count = 0;
+            for (int i = 0; i < SIZE; ++i) count += (pinned[i] || refs[i] > 0) ? 1 : 0;
+            return count;
+        }
+    };
+
+    PushPalette& palette;
+    Channel rgb;
+    Channel white;
+    bool listsBuilt = false;
+
+    // Perceptual quantization: channel value -> value snapped to levels spaced evenly in lightness
+    int quantizationLevels = 0;
+    uint8_t quantized[256];
+
+    static uint32_t rgbKey(uint8_t r, uint8_t g, uint8_t b) {
+        return (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b;
+    }
+
+    // Free indices go on the LRU lists once, after all pins are known
+    void buildLists() {
+        if (listsBuilt) return;
+        for (int i = 0; i < SIZE; ++i) {
+            if (!rgb.pinned[i]) rgb.append(i);
+            if (!white.pinned[i]) white.append(i);
+        }
+        listsBuilt = true;
+    }
+
+public:
+    explicit PaletteAllocator(PushPalette& devicePalette) : palette(devicePalette) {
+        setQuantizationLevels(0);
+    }
+
+    // Reserve an index with a fixed colour; must be called before the first acquire
+    void pinRGB(uint8_t index, uint8_t r, uint8_t g, uint8_t b) {
+        if (index >= SIZE) return;
+        rgb.pin(index, rgbKey(r, g, b));
+        PushPalette::Entry entry = palette.get(index);
+        entry.r = r; entry.g = g; entry.b = b;
+        palette.set(index, entry);
+    }
+
+    void pinWhite(uint8_t index, uint8_t w) {
+        if (index >= SIZE) return;
+        white.pin(index, w);
+        PushPalette::Entry entry = palette.get(index);
+        entry.w = w;
+        palette.set(index, entry);
+    }
+
+    // 0 = exact colours; otherwise the number of levels per channel (2-255)
+    void setQuantizationLevels(int levels) {
+        quantizationLevels = (levels >= 2 && levels < 256) ? levels : 0;
+        for (int v = 0; v < 256; ++v) {
+            if (quantizationLevels == 0) {
+                quantized[v] = static_cast<uint8_t>(v);
+                continue;
+            }
+            // Steps are even in sqrt space, so dark colours keep more of their distinctions
+            double step = std::round(std::sqrt(v / 255.0) * (quantizationLevels - 1));
+            double level = step / (quantizationLevels - 1);
+            quantized[v] = static_cast<uint8_t>(std::lround(level * level * 255.0));
+        }
+    }
+
+    int getQuantizationLevels() const { return quantizationLevels; }
+
+    // Index showing this colour on RGB LEDs; the caller holds a reference until releaseRGB
+    uint8_t acquireRGB(const Color& color) {
+        buildLists();
+        uint8_t r = quantized[color.r], g = quantized[color.g], b = quantized[color.b];
+        bool claimed;
+        int slot = rgb.acquire(rgbKey(r, g, b), claimed);
+        if (slot < 0) return 0;
+        if (claimed) {
+            PushPalette::Entry entry = palette.get(static_cast<uint8_t>(slot));
+            entry.r = r; entry.g = g; entry.b = b;
+            palette.set(static_cast<uint8_t>(slot), entry);
+        }
+        return static_cast<uint8_t>(slot);
+    }
+
+    // Index showing this brightness on BW LEDs; the caller holds a reference until releaseWhite
+    uint8_t acquireWhite(uint8_t brightness) {
+        buildLists();
+        bool claimed;
+        int slot = white.acquire(brightness, claimed);
+        if (slot < 0) return 0;
+        if (claimed) {
+            PushPalette::Entry entry = palette.get(static_cast<uint8_t>(slot));
+            entry.w = brightness;
+            palette.set(static_cast<uint8_t>(slot), entry);
+        }
+        return static_cast<uint8_t>(slot);
+    }
+
+    void releaseRGB(uint8_t index) { rgb.release(index); }
+    void releaseWhite(uint8_t index) { white.release(index); }
+
+    void printStats() const {
+        std::cout << "Palette allocation: rgb " << rgb.inUse() << " in use, " << rgb.hits << " hits, " << rgb.misses
+                  << " misses, " << rgb.evictions << " evictions; white " << white.inUse() << " in use, " << white.hits
+                  << " hits, " << white.misses << " misses, " << white.evictions << " evictions";
+        if (rgb.exhausted + white.exhausted > 0) {
+            std::cout << "; " << (rgb.exhausted + white.exhausted) << " requests found no free index";
+        }
+        std::cout << "; quantization " << (quantizationLevels ? std::to_string(quantizationLevels) + " levels" : std::string("off"))
+                  << std::endl;
+    }
+};
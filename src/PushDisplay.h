@@ -60,11 +60,14 @@ public:
         }
     }
     
-    void sendToDevice() {
-        // Get the rendered image data from canvas
+    // Get the rendered image data from canvas
+    void capture() {
         canvas->get_image_data(displayBuffer, DISPLAY_WIDTH, DISPLAY_HEIGHT, 
                              DISPLAY_WIDTH * 4, 0, 0);
-                             
+    }
+
+    // Send the last captured frame
+    void sendToDevice() {
         if (pushDevice.isDeviceConnected()) {
             pushDevice.sendDisplayFrameBlocking(displayBuffer);
         }
@@ -0,0 +1,327 @@
+#pragma once
+
+#include "RtMidi.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <iostream>
+
+#define NOMINMAX
+#include "libusb.h"
+
+#include "PushTransport.h"
+
+#define ABLETON_VENDOR_ID 0x2982
+#define PUSH2_PRODUCT_ID  0x1967
+
+// The real Push 2: RtMidi ports named "Push 2" and the display on libusb bulk endpoint 0x01
+class PushHardwareTransport : public PushTransport {
+private:
+    // RtMidi objects
+    std::unique_ptr<RtMidiIn> midiIn;
+    std::unique_ptr<RtMidiOut> midiOut;
+    MidiInput midiInput;
+
+    libusb_device_handle* deviceHandle = nullptr;
+    bool usbInitialized = false;    // one libusb_init per transport, undone in the destructor
+
+    // Rescans use their own RtMidi clients, so polling never touches the open ports
+    std::unique_ptr<RtMidiIn> scanIn;
+    std::unique_ptr<RtMidiOut> scanOut;
+
+    // libusb hotplug events, handled on their own thread
+    PlugHandler plugHandler;
+    libusb_hotplug_callback_handle hotplugHandle = 0;
+    bool hotplugRegistered = false;
+    std::atomic<bool> usbEventsStopped{false};
+    std::thread usbEventThread;
+
+    // Static callback for RtMidi (C-style callback required)
+    static void midiInputCallback(double timeStamp, std::vector<unsigned char>* message, void* userData) {
+        (void)timeStamp;
+        PushHardwareTransport* transport = static_cast<PushHardwareTransport*>(userData);
+        if (transport && transport->midiInput && !message->empty()) {
+            transport->midiInput(message->data(), message->size());
+        }
+    }
+    
+    static int LIBUSB_CALL hotplugCallback(libusb_context* context, libusb_device* device,
+                                           libusb_hotplug_event event, void* userData) {
+        (void)context;
+        (void)device;
+        PushHardwareTransport* transport = static_cast<PushHardwareTransport*>(userData);
+        if (transport && transport->plugHandler) {
+            transport->plugHandler(event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED);
+        }
+        return 0; // stay registered
+    }
+
+    // Index of the first port named like a Push 2, or -1
+    static int findPush2Port(RtMidi& midi) {
+        unsigned int portCount = midi.getPortCount();
+        for (unsigned int i = 0; i < portCount; i++) {
+            std::string portName = midi.getPortName(i);
+            if (portName.find("Push 2") != std::string::npos ||
+                portName.find("Ableton Push 2") != std::string::npos) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    // Find Push 2 MIDI ports
+    bool findPush2MidiPorts(unsigned int& inputPort, unsigned int& outputPort) {
+        int input = findPush2Port(*midiIn);
+        if (input >= 0) {
+            inputPort = static_cast<unsigned int>(input);
+            std::cout << "Found Push 2 input port: " << midiIn->getPortName(inputPort) << std::endl;
+        }
+
+        int output = findPush2Port(*midiOut);
+        if (output >= 0) {
+            outputPort = static_cast<unsigned int>(output);
+            std::cout << "Found Push 2 output port: " << midiOut->getPortName(outputPort) << std::endl;
+        }
+
+        return input >= 0 && output >= 0;
+    }
+
+    bool initializeUsb() {
+        if (usbInitialized) return true;
+        int result;
+        if ((result = libusb_init(NULL)) < 0) {
+            std::cout << "error: [" << result << "] could not initilialize usblib" << std::endl;
+            return false;
+        }
+        libusb_set_debug(NULL, LIBUSB_LOG_LEVEL_ERROR);
+        usbInitialized = true;
+        return true;
+    }
+
+    static libusb_device_handle* open_push2_device(){
+        int result;
+
+        libusb_device** devices;
+        ssize_t count;
+        count = libusb_get_device_list(NULL, &devices);
+        if (count < 0) {
+            std::cout << "error: [" << count << "] could not get usb device list" << std::endl;
+            return NULL;
+        }
+
+        libusb_device* device;
+        libusb_device_handle* device_handle = NULL;
+
+        std::string ErrorMsg;
+
+        // set message in case we get to the end of the list w/o finding a device
+        ErrorMsg = "error: Ableton Push 2 device not found";
+
+        for (int i = 0; (device = devices[i]) != NULL; i++) {
+            struct libusb_device_descriptor descriptor;
+            if ((result = libusb_get_device_descriptor(device, &descriptor)) < 0) {
+                ErrorMsg = "error: [" + std::to_string(result) + "] could not get usb device descriptor";
+                continue;
+            }
+
+            if (descriptor.bDeviceClass == LIBUSB_CLASS_PER_INTERFACE && descriptor.idVendor == ABLETON_VENDOR_ID && descriptor.idProduct == PUSH2_PRODUCT_ID) {
+                if ((result = libusb_open(device, &device_handle)) < 0) {
+                    ErrorMsg = "error: [" + std::to_string(result) + "] could not open Ableton Push 2 device";
+                } else if ((result = libusb_claim_interface(device_handle, 0)) < 0) {
+                    ErrorMsg = "error: [" + std::to_string(result) + "] could not claim interface 0 of Push 2 device";
+                    libusb_close(device_handle);
+                    device_handle = NULL;
+                } else {
+                    break; // successfully opened
+                }
+            }
+        }
+
+        if (device_handle == NULL) {
+            std::cout << ErrorMsg << std::endl;
+        }
+
+        libusb_free_device_list(devices, 1);
+        return device_handle;
+    }
+
+    static void close_push2_device(libusb_device_handle* device_handle) {
+        libusb_release_interface(device_handle, 0);
+        libusb_close(device_handle);
+    }
+    
+public:
+    PushHardwareTransport() {
+        try {
+            midiIn = std::make_unique<RtMidiIn>();
+            midiOut = std::make_unique<RtMidiOut>();
+            scanIn = std::make_unique<RtMidiIn>();
+            scanOut = std::make_unique<RtMidiOut>();
+        } catch (RtMidiError& error) {
+            std::cerr << "RtMidi initialization error: " << error.getMessage() << std::endl;
+        }
+    }
+
+    ~PushHardwareTransport() override {
+        stopPlugEvents();
+        close();
+        if (usbInitialized) {
+            libusb_exit(NULL);
+        }
+    }
+
+    const char* name() const override { return "Push 2"; }
+
+    bool initialize() override {
+        return midiIn && midiOut;
+    }
+
+    bool openMidi(MidiInput input) override {
+        if (!midiIn || !midiOut) {
+            std::cerr << "MIDI objects not initialized" << std::endl;
+            return false;
+        }
+
+        try {
+            unsigned int inputPort, outputPort;
+            if (!findPush2MidiPorts(inputPort, outputPort)) {
+                std::cerr << "Could not find Push 2 MIDI ports" << std::endl;
+                std::cout << "\nAvailable MIDI Input Ports:" << std::endl;
+                for (unsigned int i = 0; i < midiIn->getPortCount(); i++) {
+                    std::cout << "  " << i << ": " << midiIn->getPortName(i) << std::endl;
+                }
+                std::cout << "\nAvailable MIDI Output Ports:" << std::endl;
+                for (unsigned int i = 0; i < midiOut->getPortCount(); i++) {
+                    std::cout << "  " << i << ": " << midiOut->getPortName(i) << std::endl;
+                }
+                return false;
+            }
+
+            // Open MIDI ports
+            midiIn->openPort(inputPort);
+            midiOut->openPort(outputPort);
+
+            // Set up input callback - THIS IS IMPORTANT FOR RECEIVING INPUT
+            midiInput = std::move(input);
+            midiIn->setCallback(&midiInputCallback, this);
+            midiIn->ignoreTypes(false, false, false); // Don't ignore any message types
+        } catch (RtMidiError& error) {
+            std::cerr << "MIDI connection error: " << error.getMessage() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool openDisplay() override {
+        if (deviceHandle) return true;
+        std::cout << "Opening Push 2 USB display..." << std::endl;
+        if (!initializeUsb()) return false;
+        deviceHandle = open_push2_device();
+        if (!deviceHandle) {
+            std::cerr << "Failed to open Push 2 USB display" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void close() override {
+        try {
+            if (midiIn && midiIn->isPortOpen()) {
+                midiIn->cancelCallback();
+                midiIn->closePort();
+            }
+            if (midiOut && midiOut->isPortOpen()) {
+                midiOut->closePort();
+            }
+        } catch (RtMidiError& error) {
+            std::cerr << "MIDI disconnect error: " << error.getMessage() << std::endl;
+        }
+
+        if (deviceHandle) {
+            std::cout << "Closing Push 2 USB display..." << std::endl;
+            close_push2_device(deviceHandle);
+            deviceHandle = nullptr;
+        }
+    }
+
+    bool writeMidi(const uint8_t* data, size_t size) override {
+        if (!midiOut || !midiOut->isPortOpen()) {
+            return false;
+        }
+        try {
+            midiOut->sendMessage(data, size);
+            return true;
+        } catch (RtMidiError& error) {
+            std::cerr << "MIDI send error: " << error.getMessage() << std::endl;
+            return false;
+        }
+    }
+
+    // ALSA and CoreMIDI parse a byte stream of several messages; WinMM only takes one short
+    // message (or one SysEx) per call
+    bool acceptsMidiStreams() const override {
+        return midiOut && midiOut->getCurrentApi() != RtMidi::WINDOWS_MM;
+    }
+
+    bool hasDisplay() const override { return deviceHandle != nullptr; }
+
+    bool writeDisplay(const uint8_t* data, int size, unsigned int timeoutMs) override {
+        if (!deviceHandle) return false;
+        int transferred = 0;
+        int result = libusb_bulk_transfer(deviceHandle, 0x01, const_cast<uint8_t*>(data), size, &transferred, timeoutMs);
+        if (result != 0 || transferred != size) {
+            std::cerr << "Display transfer failed: " << result << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Both Push 2 MIDI ports are listed (the OS enumerates them shortly after the USB device)
+    bool isPresent() override {
+        if (!scanIn || !scanOut) return false;
+        try {
+            return findPush2Port(*scanOut) >= 0 && findPush2Port(*scanIn) >= 0;
+        } catch (RtMidiError&) {
+            return false;
+        }
+    }
+
+    // libusb reports hotplug on Linux and macOS; on Windows this returns false and rescans do the work
+    bool watchPlugEvents(PlugHandler handler) override {
+        if (hotplugRegistered) return true;
+        if (!initializeUsb() || !libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+            return false;
+        }
+        plugHandler = std::move(handler);
+        int result = libusb_hotplug_register_callback(NULL,
+            LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT, LIBUSB_HOTPLUG_NO_FLAGS,
+            ABLETON_VENDOR_ID, PUSH2_PRODUCT_ID, LIBUSB_HOTPLUG_MATCH_ANY, &hotplugCallback, this, &hotplugHandle);
+        if (result != LIBUSB_SUCCESS) {
+            std::cerr << "error: [" << result << "] could not register for Push 2 hotplug events" << std::endl;
+            plugHandler = nullptr;
+            return false;
+        }
+        hotplugRegistered = true;
+        usbEventsStopped.store(false);
+        usbEventThread = std::thread([this]() {
+            while (!usbEventsStopped.load()) {
+                timeval timeout{0, 100000};
+                libusb_handle_events_timeout_completed(NULL, &timeout, NULL);
+            }
+        });
+        return true;
+    }
+
+    void stopPlugEvents() override {
+        if (!hotplugRegistered) return;
+        usbEventsStopped.store(true);
+        libusb_hotplug_deregister_callback(NULL, hotplugHandle); // also wakes the event thread
+        if (usbEventThread.joinable()) {
+            usbEventThread.join();
+        }
+        hotplugRegistered = false;
+        plugHandler = nullptr;
+    }
+};
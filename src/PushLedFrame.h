@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PUSH_LED_FRAME_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define PUSH_LED_FRAME_NEON 1
+#endif
+
+// Everything the Push 2's LEDs should show, as plain colours rather than palette indices, so two
+// frames can be compared without touching the palette. One 64-bit word per LED:
+// bits 0-23 target colour (0xRRGGBB, or the brightness for BW buttons), bits 24-47 the colour an
+// animation starts from, bits 48-55 the MIDI channel (0 = static, which leaves the start colour 0).
+struct alignas(16) PushLedFrame {
+    static constexpr int PADS = 64;
+    static constexpr int BUTTONS = 128;         // cc0-cc119, padded to whole vectors
+    static constexpr int TOUCH_STRIP = 32;      // 31 LEDs, padded
+    static constexpr uint64_t UNKNOWN = ~0ull;  // matches no real LED word, forces a resend
+
+    uint64_t pads[PADS];
+    uint64_t buttons[BUTTONS];
+    uint8_t touchStrip[TOUCH_STRIP];
+
+    PushLedFrame() { clear(); }
+
+    static uint64_t pack(uint32_t to, uint32_t from, uint8_t channel) {
+        if (channel == 0) return to;
+        return static_cast<uint64_t>(to) | (static_cast<uint64_t>(from) << 24) | (static_cast<uint64_t>(channel) << 48);
+    }
+    static uint32_t target(uint64_t word) { return static_cast<uint32_t>(word & 0xFFFFFF); }
+    static uint32_t from(uint64_t word) { return static_cast<uint32_t>((word >> 24) & 0xFFFFFF); }
+    static uint8_t channel(uint64_t word) { return static_cast<uint8_t>(word >> 48); }
+
+    // All LEDs off
+    void clear() {
+        std::memset(pads, 0, sizeof(pads));
+        std::memset(buttons, 0, sizeof(buttons));
+        std::memset(touchStrip, 0, sizeof(touchStrip));
+    }
+
+    // Nothing is known to be on the device
+    void invalidate() {
+        std::memset(pads, 0xFF, sizeof(pads));
+        std::memset(buttons, 0xFF, sizeof(buttons));
+        std::memset(touchStrip, 0xFF, sizeof(touchStrip));
+    }
+
+    // Whole-frame check, the common case once nothing changes
+    bool equals(const PushLedFrame& other) const {
+        static_assert(sizeof(PushLedFrame) % 16 == 0, "frame must be a whole number of vectors");
+        const uint8_t* a = reinterpret_cast<const uint8_t*>(this);
+        const uint8_t* b = reinterpret_cast<const uint8_t*>(&other);
+#if defined(PUSH_LED_FRAME_SSE2)
+        __m128i differences = _mm_setzero_si128();
+        for (size_t i = 0; i < sizeof(PushLedFrame); i += 16) {
+            differences = _mm_or_si128(differences, _mm_xor_si128(
+                _mm_load_si128(reinterpret_cast<const __m128i*>(a + i)),
+                _mm_load_si128(reinterpret_cast<const __m128i*>(b + i))));
+        }
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(differences, _mm_setzero_si128())) == 0xFFFF;
+#elif defined(PUSH_LED_FRAME_NEON)
+        uint8x16_t differences = vdupq_n_u8(0);
+        for (size_t i = 0; i < sizeof(PushLedFrame); i += 16) {
+            differences = vorrq_u8(differences, veorq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+        }
+        return vmaxvq_u8(differences) == 0;
+#else
+        return std::memcmp(a, b, sizeof(PushLedFrame)) == 0;
+#endif
+    }
+
+    // Indices of the words that differ between a and b (count must be even); returns how many
+    static int diffWords(const uint64_t* a, const uint64_t* b, int count, uint8_t* changed) {
+        int found = 0;
+        for (int i = 0; i < count; i += 2) {
+#if defined(PUSH_LED_FRAME_SSE2)
+            __m128i equal = _mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                           _mm_load_si128(reinterpret_cast<const __m128i*>(b + i)));
+            int mask = _mm_movemask_epi8(equal);
+            if (mask == 0xFFFF) continue;
+            if ((mask & 0x00FF) != 0x00FF) changed[found++] = static_cast<uint8_t>(i);
+            if ((mask & 0xFF00) != 0xFF00) changed[found++] = static_cast<uint8_t>(i + 1);
+#elif defined(PUSH_LED_FRAME_NEON)
+            uint64x2_t equal = vceqq_u64(vld1q_u64(a + i), vld1q_u64(b + i));
+            if (vgetq_lane_u64(equal, 0) == ~0ull && vgetq_lane_u64(equal, 1) == ~0ull) continue;
+            if (vgetq_lane_u64(equal, 0) != ~0ull) changed[found++] = static_cast<uint8_t>(i);
+            if (vgetq_lane_u64(equal, 1) != ~0ull) changed[found++] = static_cast<uint8_t>(i + 1);
+#else
+            if (a[i] != b[i]) changed[found++] = static_cast<uint8_t>(i);
+            if (a[i + 1] != b[i + 1]) changed[found++] = static_cast<uint8_t>(i + 1);
+#endif
+        }
+        return found;
+    }
+
+    bool touchStripDiffers(const PushLedFrame& other) const {
+        return std::memcmp(touchStrip, other.touchStrip, TOUCH_STRIP) != 0;
+    }
+};
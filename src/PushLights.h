@@ -1,8 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+
 #include "PushUSB.h"
+#include "PushPalette.h"
+#include "PaletteAllocator.h"
+#include "PushLedFrame.h"
+#include "PushTouchStripMeter.h"
 #include "Color.h"
-#include <map>
 
 #define PALETTE_BLACK 0
 #define PALETTE_RGB_WHITE 122
@@ -10,6 +16,24 @@
 
 class PushUI; // Forward declaration
 
+// Animations the Push 2 runs on its own, selected by the MIDI channel of the LED message.
+// The LED moves between the colour it was given on channel 1 and the colour sent with the animation.
+enum class LedAnimation : uint8_t {
+    Static = 0,     // channel 1
+    OneShot = 1,    // channels 2-6: fade once to the new colour
+    Pulse = 6,      // channels 7-11
+    Blink = 11      // channels 12-16
+};
+
+// Animation speed, locked to MIDI clock (120 BPM without one)
+enum class LedAnimationRate : uint8_t {
+    TwentyFourth = 0,
+    Sixteenth = 1,
+    Eighth = 2,
+    Quarter = 3,
+    Half = 4
+};
+
 // PushLights class - handles all LED lighting
 class PushLights {
 private:
@@ -18,33 +42,45 @@ private:
     static const int PAD_ROWS = 8;
     static const int PAD_COLS = 8;
     static const int FIRST_PAD_NOTE = 36;
+
+    // Palette indices an LED was last sent. Animated LEDs also hold the index they animate from.
+    struct LedState {
+        uint8_t index = PALETTE_BLACK;
+        uint8_t fromIndex = PALETTE_BLACK;
+        uint8_t channel = 0;            // 0 = static, otherwise LedAnimation + LedAnimationRate
+
+        bool operator==(const LedState& other) const {
+            return index == other.index && channel == other.channel && (channel == 0 || fromIndex == other.fromIndex);
+        }
+    };
+
     // Use a fixed array for 64 pads
-    uint8_t currentPadPaletteIndices[64] = {0};
+    LedState padStates[64];
     // Use a fixed array for all buttons (cc0-cc119)
-    uint8_t currentButtonPaletteIndices[120] = {0};
-    // Touchstrip LED state (31 LEDs, values 0-7)
-    uint8_t currentTouchStripLEDs[31] = {0};
+    LedState buttonStates[120];
     bool lightsInitialized;
+    std::atomic<bool> restorePending{false};  // the device came back empty; see requestRestore()
 
-    // Unified palette: index -> {r,g,b,w}
-    struct PaletteEntry {
-        uint8_t r, g, b, w;
-    };
+    // The frame being built and the one the device shows; commitFrame() sends the difference
+    PushLedFrame desired;
+    PushLedFrame sent;
 
-    std::map<uint8_t, PaletteEntry> palette = {
-        {PALETTE_BLACK,        {0, 0, 0, 0}},        // black
-        {16,                  {0,0,0,32}},           // dark gray
-        {48,                  {0,0,0,84}},           // light gray
-        {PALETTE_RGB_WHITE,   {204, 204, 204, 0}},   // white
-        {123,                 {64, 64, 64, 0}},      // rgb light gray
-        {124,                 {20, 20, 20, 0}},      // rgb dark gray
-        {125,                 {0, 0, 255, 0}},       // blue
-        {126,                 {0, 255, 0, 0}},       // green
-        {PALETTE_BW_WHITE,    {255, 0, 0, 128}}      // rgb red, bw white
-    };
-    
-    uint8_t nextCustomPaletteIndex = 10; // Start at 10, avoid 0 and high reserved values
-    static constexpr uint8_t MAX_CUSTOM_PALETTE_INDEX = 121; // 122+ reserved
+    // When each pad/button was last pressed (steady clock ticks); LED changes within
+    // FEEDBACK_WINDOW_MS of that are the performer's feedback and go out ahead of repaints.
+    // Long enough to cover the round trip through Resolume.
+    static constexpr int FEEDBACK_WINDOW_MS = 250;
+    std::atomic<int64_t> padInputAt[64] = {};
+    std::atomic<int64_t> buttonInputAt[120] = {};
+
+    // Pre-encoded meter pictures; the state the desired touch strip shows, -1 if not a meter
+    PushTouchStripMeter touchStripMeter;
+    int touchStripMeterState = -1;
+
+    // What the device's palette should hold; only changes are sent, once per frame
+    PushPalette devicePalette;
+
+    // Colour -> palette index, reference counted per LED
+    PaletteAllocator paletteAllocator;
 
     // Helper: is this button RGB?
     static inline bool isRGBButton(int cc) {
@@ -56,93 +92,128 @@ private:
             cc == 85 || cc == 86 || cc == 89;
     }
 
-    // Helper: get nearest palette index for BW brightness (0-128)
-    uint8_t getBWPaletteIndex(uint8_t brightness) {
-        // Search for an entry with matching w (ignore r,g,b)
-        for (const auto& kv : palette) {
-            if (kv.second.w == brightness) {
-                return kv.first;
-            }
+    static uint8_t animationChannel(LedAnimation animation, LedAnimationRate rate) {
+        if (animation == LedAnimation::Static) return 0;
+        return static_cast<uint8_t>(static_cast<uint8_t>(animation) + static_cast<uint8_t>(rate));
+    }
+
+    // Give back the palette references an LED state holds
+    void releaseState(const LedState& state, bool rgb) {
+        if (rgb) {
+            paletteAllocator.releaseRGB(state.index);
+            if (state.channel != 0) paletteAllocator.releaseRGB(state.fromIndex);
+        } else {
+            paletteAllocator.releaseWhite(state.index);
+            if (state.channel != 0) paletteAllocator.releaseWhite(state.fromIndex);
         }
-        // Not found: find first available/unused index (0-121)
-        for (uint8_t idx = 0; idx <= MAX_CUSTOM_PALETTE_INDEX; ++idx) {
-            if (palette.find(idx) == palette.end()) {
-                PaletteEntry entry = {0, 0, 0, brightness};
-                palette[idx] = entry;
-                pushDevice.setPaletteEntry(idx, entry.r, entry.g, entry.b, entry.w);
-                return idx;
-            }
+    }
+
+    // Animations start from the colour set on channel 1, so that goes first
+    void sendPadState(int note, const LedState& state, MidiPriority priority) {
+        if (state.channel != 0) {
+            pushDevice.setPadColorIndex(note, state.fromIndex, 0, priority);
         }
-        std::cerr << "PushLights: Out of palette indices for custom BW values!" << std::endl;
-        return 0;
+        pushDevice.setPadColorIndex(note, state.index, state.channel, priority);
     }
 
-    // Unified: get or create palette index for RGB color, preserving W if already present
-    uint8_t getRGBPaletteIndex(const Color& color) {
-        // Search for an entry with matching r,g,b (ignore w)
-        for (const auto& kv : palette) {
-            if (kv.second.r == color.r && kv.second.g == color.g && kv.second.b == color.b) {
-                return kv.first;
-            }
+    void sendButtonState(int cc, const LedState& state, MidiPriority priority) {
+        if (state.channel != 0) {
+            pushDevice.setButtonColorIndex(cc, state.fromIndex, 0, priority);
         }
-        // Not found: find first available/unused index (0-121)
-        for (uint8_t idx = 0; idx <= MAX_CUSTOM_PALETTE_INDEX; ++idx) {
-            if (palette.find(idx) == palette.end()) {
-                PaletteEntry entry = {color.r, color.g, color.b, 0};
-                palette[idx] = entry;
-                pushDevice.setPaletteEntry(idx, entry.r, entry.g, entry.b, entry.w);
-                return idx;
-            }
+        pushDevice.setButtonColorIndex(cc, state.index, state.channel, priority);
+    }
+
+    // Show a new state on a pad if it differs (or force); takes over the references in next
+    void applyPadState(int idx, const LedState& next, bool force, MidiPriority priority) {
+        LedState& current = padStates[idx];
+        if (current == next && !force) {
+            releaseState(next, true);
+            return;
         }
-        std::cerr << "PushLights: Out of palette indices for custom RGB values!" << std::endl;
-        return 0;
-    }
-
-    // Set the white part of a palette entry, preserving RGB if present
-    void setPaletteEntryWhite(uint8_t idx, uint8_t w) {
-        PaletteEntry entry = {0, 0, 0, w};
-        auto it = palette.find(idx);
-        if (it != palette.end()) {
-            entry.r = it->second.r;
-            entry.g = it->second.g;
-            entry.b = it->second.b;
+        sendPadState(FIRST_PAD_NOTE + idx, next, priority);
+        releaseState(current, true);
+        current = next;
+    }
+
+    void applyButtonState(int cc, const LedState& next, bool force, MidiPriority priority) {
+        LedState& current = buttonStates[cc];
+        bool rgb = isRGBButton(cc);
+        if (current == next && !force) {
+            releaseState(next, rgb);
+            return;
         }
-        palette[idx] = entry;
-        pushDevice.setPaletteEntry(idx, entry.r, entry.g, entry.b, entry.w);
+        sendButtonState(cc, next, priority);
+        releaseState(current, rgb);
+        current = next;
     }
 
-    // Set the RGB part of a palette entry, preserving W if present
-    void setPaletteEntryRGB(uint8_t idx, uint8_t r, uint8_t g, uint8_t b) {
-        PaletteEntry entry = {r, g, b, 0};
-        auto it = palette.find(idx);
-        if (it != palette.end()) {
-            entry.w = it->second.w;
+    static int64_t nowTicks() {
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+
+    static MidiPriority priorityFor(const std::atomic<int64_t>& inputAt, int64_t feedbackSince) {
+        int64_t at = inputAt.load(std::memory_order_relaxed);
+        return (at != 0 && at >= feedbackSince) ? MidiPriority::Feedback : MidiPriority::Repaint;
+    }
+
+    static uint32_t colorKey(const Color& color) {
+        return (static_cast<uint32_t>(color.r) << 16) | (static_cast<uint32_t>(color.g) << 8) | color.b;
+    }
+
+    uint8_t acquireColor(uint32_t key, bool rgb) {
+        if (!rgb) return paletteAllocator.acquireWhite(static_cast<uint8_t>(key));
+        return paletteAllocator.acquireRGB(Color(static_cast<uint8_t>(key >> 16), static_cast<uint8_t>(key >> 8),
+                                                 static_cast<uint8_t>(key)));
+    }
+
+    // Palette indices for a frame word; the caller owns the references
+    LedState acquireState(uint64_t word, bool rgb) {
+        LedState state;
+        state.index = acquireColor(PushLedFrame::target(word), rgb);
+        state.channel = PushLedFrame::channel(word);
+        if (state.channel != 0) {
+            state.fromIndex = acquireColor(PushLedFrame::from(word), rgb);
         }
-        palette[idx] = entry;
-        pushDevice.setPaletteEntry(idx, entry.r, entry.g, entry.b, entry.w);
+        return state;
     }
 
 public:
-    PushLights(PushUSB& push) : pushDevice(push), parentUI(nullptr), lightsInitialized(false) {
-        for (int i = 0; i < 64; ++i) currentPadPaletteIndices[i] = PALETTE_BLACK;
-        for (int i = 0; i < 120; ++i) currentButtonPaletteIndices[i] = 0;
-        for (int i = 0; i < 31; ++i) currentTouchStripLEDs[i] = 0;
+    PushLights(PushUSB& push) : pushDevice(push), parentUI(nullptr), lightsInitialized(false), devicePalette(push),
+        paletteAllocator(devicePalette) {
+        // Fixed entries
+        paletteAllocator.pinRGB(PALETTE_BLACK, 0, 0, 0);
+        paletteAllocator.pinWhite(PALETTE_BLACK, 0);
+        paletteAllocator.pinWhite(16, 32);                       // dark gray
+        paletteAllocator.pinWhite(48, 84);                       // light gray
+        paletteAllocator.pinRGB(PALETTE_RGB_WHITE, 204, 204, 204);
+        paletteAllocator.pinRGB(123, 64, 64, 64);                // rgb light gray
+        paletteAllocator.pinRGB(124, 20, 20, 20);                // rgb dark gray
+        paletteAllocator.pinRGB(125, 0, 0, 255);                 // blue
+        paletteAllocator.pinRGB(126, 0, 255, 0);                 // green
+        paletteAllocator.pinRGB(PALETTE_BW_WHITE, 255, 0, 0);    // rgb red
+        paletteAllocator.pinWhite(PALETTE_BW_WHITE, 128);        // bw white
 
         pushDevice.configureTouchStrip();
     }
 
     void setParentUI(PushUI* parent) { parentUI = parent; }
 
-    // Set pad color using note number (only sends if palette index changed)
-    void setPadColor(int note, const Color& color) {
-        if (note < FIRST_PAD_NOTE || note > FIRST_PAD_NOTE + 63) return;
-        uint8_t paletteIdx = getRGBPaletteIndex(color);
-        int idx = note - FIRST_PAD_NOTE;
-        if (currentPadPaletteIndices[idx] == paletteIdx) {
-            return;
+    // The performer pressed a pad or button; may be called from any thread
+    void notePadInput(int note) {
+        if (note >= FIRST_PAD_NOTE && note < FIRST_PAD_NOTE + 64) {
+            padInputAt[note - FIRST_PAD_NOTE].store(nowTicks(), std::memory_order_relaxed);
         }
-        pushDevice.setPadColorIndex(note, paletteIdx);
-        currentPadPaletteIndices[idx] = paletteIdx;
+    }
+
+    void noteButtonInput(int cc) {
+        if (cc >= 0 && cc < 120) {
+            buttonInputAt[cc].store(nowTicks(), std::memory_order_relaxed);
+        }
+    }
+
+    // Set pad color using note number (sent by the next commitFrame if it changed)
+    void setPadColor(int note, const Color& color) {
+        setPadAnimation(note, color, color, LedAnimation::Static, LedAnimationRate::Quarter);
     }
 
     // Set pad color using row/column (0-based)
@@ -153,53 +224,108 @@ public:
         }
     }
 
+    // Let the pad animate between two colours on its own; sent once, then runs on the device
+    void setPadAnimation(int note, const Color& from, const Color& to, LedAnimation animation, LedAnimationRate rate) {
+        if (note < FIRST_PAD_NOTE || note > FIRST_PAD_NOTE + 63) return;
+        desired.pads[note - FIRST_PAD_NOTE] = PushLedFrame::pack(colorKey(to), colorKey(from), animationChannel(animation, rate));
+    }
+
+    void setPadAnimation(int row, int col, const Color& from, const Color& to, LedAnimation animation, LedAnimationRate rate) {
+        if (row >= 0 && row < PAD_ROWS && col >= 0 && col < PAD_COLS) {
+            setPadAnimation(FIRST_PAD_NOTE + (row * PAD_COLS + col), from, to, animation, rate);
+        }
+    }
+
     // Set button color for BW button (brightness 0-128)
     void setButtonColorBW(int cc, uint8_t brightness) {
+        setButtonAnimationBW(cc, brightness, brightness, LedAnimation::Static, LedAnimationRate::Quarter);
+    }
+
+    // Set button color for RGB button
+    void setButtonColorRGB(int cc, const Color& color) {
+        setButtonAnimationRGB(cc, color, color, LedAnimation::Static, LedAnimationRate::Quarter);
+    }
+
+    void setButtonAnimationBW(int cc, uint8_t from, uint8_t to, LedAnimation animation, LedAnimationRate rate) {
         if (cc < 0 || cc >= 120) return;
         if (isRGBButton(cc)) {
             std::cerr << "setButtonColorBW: cc" << cc << " is not a BW button!" << std::endl;
             return;
         }
-        uint8_t paletteIdx = getBWPaletteIndex(brightness);
-        // Set the white part of the palette entry, preserving RGB
-        setPaletteEntryWhite(paletteIdx, brightness);
-        if (currentButtonPaletteIndices[cc] == paletteIdx) return;
-        pushDevice.setButtonColorIndex(cc, paletteIdx);
-        currentButtonPaletteIndices[cc] = paletteIdx;
+        desired.buttons[cc] = PushLedFrame::pack(to, from, animationChannel(animation, rate));
     }
 
-    // Set button color for RGB button
-    void setButtonColorRGB(int cc, const Color& color) {
+    void setButtonAnimationRGB(int cc, const Color& from, const Color& to, LedAnimation animation, LedAnimationRate rate) {
         if (cc < 0 || cc >= 120) return;
         if (!isRGBButton(cc)) {
             std::cerr << "setButtonColorRGB: cc" << cc << " is not an RGB button!" << std::endl;
             return;
         }
-        uint8_t paletteIdx = getRGBPaletteIndex(color);
-        // Set the RGB part of the palette entry, preserving W
-        setPaletteEntryRGB(paletteIdx, color.r, color.g, color.b);
-        if (currentButtonPaletteIndices[cc] == paletteIdx) return;
-        pushDevice.setButtonColorIndex(cc, paletteIdx);
-        currentButtonPaletteIndices[cc] = paletteIdx;
+        desired.buttons[cc] = PushLedFrame::pack(colorKey(to), colorKey(from), animationChannel(animation, rate));
+    }
+
+    // Send what changed since the last commit: one message (two if animated) per changed LED,
+    // the touch strip if it changed, then any new palette entries. LEDs recently pressed and the
+    // touch strip go at feedback priority. Returns the number of LEDs sent.
+    int commitFrame() {
+        if (desired.equals(sent)) return 0;
+
+        PushUSB::MidiBatch batch(pushDevice);
+        uint8_t changed[PushLedFrame::BUTTONS];
+        int ledsSent = 0;
+        int64_t feedbackSince = nowTicks() - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::milliseconds(FEEDBACK_WINDOW_MS)).count();
+
+        int count = PushLedFrame::diffWords(desired.pads, sent.pads, PushLedFrame::PADS, changed);
+        for (int i = 0; i < count; ++i) {
+            int idx = changed[i];
+            applyPadState(idx, acquireState(desired.pads[idx], true), sent.pads[idx] == PushLedFrame::UNKNOWN,
+                          priorityFor(padInputAt[idx], feedbackSince));
+            sent.pads[idx] = desired.pads[idx];
+            ledsSent++;
+        }
+
+        count = PushLedFrame::diffWords(desired.buttons, sent.buttons, PushLedFrame::BUTTONS, changed);
+        for (int i = 0; i < count; ++i) {
+            int cc = changed[i];
+            if (cc < 120) {
+                applyButtonState(cc, acquireState(desired.buttons[cc], isRGBButton(cc)),
+                                 sent.buttons[cc] == PushLedFrame::UNKNOWN, priorityFor(buttonInputAt[cc], feedbackSince));
+                ledsSent++;
+            }
+            sent.buttons[cc] = desired.buttons[cc];
+        }
+
+        if (desired.touchStripDiffers(sent)) {
+            if (touchStripMeterState >= 0) {
+                pushDevice.sendTouchStripSysEx(touchStripMeter.message(touchStripMeterState));
+            } else {
+                pushDevice.setTouchStripLEDs(desired.touchStrip);
+            }
+            std::memcpy(sent.touchStrip, desired.touchStrip, PushLedFrame::TOUCH_STRIP);
+        }
+
+        // New or changed palette entries, then a single reapply
+        devicePalette.flush();
+        return ledsSent;
     }
 
     // Clear all pads to black (forces update)
     void clearAllPads() {
         for (int i = 0; i < 64; ++i) {
-            currentPadPaletteIndices[i] = PALETTE_BLACK;
-            pushDevice.setPadColorIndex(FIRST_PAD_NOTE + i, PALETTE_BLACK);
+            desired.pads[i] = 0;
+            sent.pads[i] = PushLedFrame::UNKNOWN;
         }
+        commitFrame();
     }
 
     // Clear all buttons (forces update)
     void clearAllButtons() {
         for (int cc = 0; cc < 120; ++cc) {
-            if(isRGBButton(cc)) {
-                setButtonColorRGB(cc, Color::BLACK);
-            } else {
-                setButtonColorBW(cc, 0);
-            }
+            desired.buttons[cc] = 0;
+            sent.buttons[cc] = PushLedFrame::UNKNOWN;
         }
+        commitFrame();
     }
 
     // Set touchstrip LEDs with array of 31 values (0-7 each)
@@ -212,81 +338,79 @@ public:
             }
         }
 
-        // Check if state has changed
-        bool changed = false;
-        for (int i = 0; i < 31; ++i) {
-            if (currentTouchStripLEDs[i] != ledValues[i]) {
-                changed = true;
-                break;
-            }
-        }
-
-        if (!changed) {
-            return; // No change needed
-        }
-
-        // Update current state
-        for (int i = 0; i < 31; ++i) {
-            currentTouchStripLEDs[i] = ledValues[i];
-        }
-
-        // Send to device
-        pushDevice.setTouchStripLEDs(ledValues);
+        std::memcpy(desired.touchStrip, ledValues, 31);
+        touchStripMeterState = -1;
     }
 
     // Set touchstrip as meter from bottom up (0.0 = off, 1.0 = full)
     void setTouchStripMeter(float level) {
-        // Clamp level to 0-1 range
-        level = std::max(0.0f, std::min(1.0f, level));
-
-        uint8_t ledValues[31] = {0};
-
-        if (level > 0.0f) {
-            // Calculate how many LEDs should be lit
-            float ledCount = level * 31.0f;
-            int fullLEDs = static_cast<int>(ledCount);
-            float remainder = ledCount - fullLEDs;
-
-            // Light up full LEDs
-            for (int i = 0; i < fullLEDs && i < 31; ++i) {
-                ledValues[i] = 7; // Full brightness
-            }
-
-            // Handle partial LED at the top
-            if (fullLEDs < 31 && remainder > 0.0f) {
-                // Scale remainder to 1-7 range (avoid 0 for partial)
-                uint8_t partialBrightness = static_cast<uint8_t>(remainder * 6.0f + 1.0f);
-                ledValues[fullLEDs] = std::min(partialBrightness, static_cast<uint8_t>(7));
-            }
-        }
-
-        setTouchStripLEDs(ledValues);
+        touchStripMeterState = PushTouchStripMeter::stateFor(level);
+        std::memcpy(desired.touchStrip, touchStripMeter.ledValues(touchStripMeterState), 31);
     }
 
     // Clear touchstrip (all LEDs off)
     void clearTouchStrip() {
-        uint8_t ledValues[31] = {0};
-        setTouchStripLEDs(ledValues);
+        setTouchStripMeter(0.0f);
+    }
+
+    void setPaletteQuantization(int levels) { paletteAllocator.setQuantizationLevels(levels); }
+
+    void printPaletteStats() const {
+        devicePalette.printStats();
+        paletteAllocator.printStats();
     }
 
     // Force complete refresh (useful after reconnection or initialization)
     void forceRefresh() {
-        for (int i = 0; i < 64; ++i) currentPadPaletteIndices[i] = PALETTE_BLACK;
-        for (int i = 0; i < 120; ++i) currentButtonPaletteIndices[i] = PALETTE_BLACK;
-        for (int i = 0; i < 31; ++i) currentTouchStripLEDs[i] = 0;
+        sent.invalidate();
+        devicePalette.invalidate();
         lightsInitialized = false;
     }
 
+    // The device was reattached and shows nothing: the next updateLights() resends the touch strip
+    // setup, every palette entry in use and every LED in the same batch. May be called from any thread.
+    void requestRestore() {
+        restorePending.store(true);
+    }
+
     // Update all lights based on current Resolume state
     void updateLights() {
+        bool restoring = restorePending.exchange(false);
+        {
+            // Everything below goes out as one MIDI write at the end of the frame; a restore as one
+            // burst, not paced behind the output budget
+            PushUSB::MidiBatch batch(pushDevice);
+            if (restoring) {
+                batch.ignoreBudget();
+                pushDevice.configureTouchStrip();
+                sent.invalidate();
+                devicePalette.invalidate();
+            }
+            composeFrame();
+        }
+        if (restoring) {
+            pushDevice.noteRestored();
+        }
+    }
+
+private:
+    // Build the frame from the tracker state and commit it; called inside updateLights()' batch
+    void composeFrame() {
         if (!lightsInitialized) {
-            // First time setup - clear everything to ensure known state
-            clearAllPads();
-            clearAllButtons();
+            // First time setup - every LED is resent, black unless the frame below lights it
+            desired.clear();
+            sent.invalidate();
             lightsInitialized = true;
         }
 
-        if (!parentUI) return;
+        if (!parentUI) {
+            commitFrame();
+            return;
+        }
+
+        // Compute the whole frame from one tracker state version
+        auto trackerLock = parentUI->getResolumeTracker().readLock();
+
         int connectedColumn = parentUI->getResolumeTracker().getConnectedColumn();
         int selectedLayer = parentUI->getResolumeTracker().getSelectedLayerId();
         int numColumns = parentUI->getNumColumns();
@@ -302,12 +426,13 @@ public:
                 setButtonColorRGB(cc, Color::BLACK);
                 continue;
             }
+            // Rainbow: evenly spaced hues, mapped to palette, based on total columns
+            float hue = (float)(column - 1) * 360.0f / std::max(1, numColumns);
+            Color c = Color::fromHSV(hue, 1.0f, 1.0f);
             if (column == connectedColumn) {
-                setButtonColorRGB(cc, Color::WHITE); // White (palette index)
+                // Pulses between its colour and white on the device, no further traffic
+                setButtonAnimationRGB(cc, c, Color::WHITE, LedAnimation::Pulse, LedAnimationRate::Quarter);
             } else {
-                // Rainbow: evenly spaced hues, mapped to palette, based on total columns
-                float hue = (float)(column - 1) * 360.0f / std::max(1, numColumns);
-                Color c = Color::fromHSV(hue, 1.0f, 1.0f);
                 setButtonColorRGB(cc, c);
             }
         }
@@ -339,6 +464,7 @@ public:
             auto layer = parentUI->getResolumeTracker().getLayer(selectedLayer);
             if (!layer) {
                 clearTouchStrip();
+                commitFrame();
                 return;
             }
 
@@ -361,27 +487,33 @@ public:
                 Color padColor = Color::BLACK;
                 //if (parentUI->resolumeTracker.getLayer(resolumeLayer)->getPlayingId() == resolumeColumn) {
                 
+                // Dimmed while the clip may be stale after packet loss
+                bool suspect = parentUI->resolumeTracker.isClipSuspect(resolumeColumn, resolumeLayer);
+
                 if (parentUI->resolumeTracker.doesClipExist(resolumeColumn, resolumeLayer)) {
-                    padColor = Color::WHITE;
+                    padColor = suspect ? Color::DIM_WHITE : Color::WHITE;
                 } 
 
                 if (parentUI->resolumeTracker.isClipPlaying(resolumeColumn, resolumeLayer)) {
                     // Lit up according to column number (rainbow)
                     float hue = (float)(resolumeColumn - 1) * 360.0f / ((float)numColumns);
-                    padColor = Color::fromHSV(hue, 1.0f, 1.0f);
+                    padColor = Color::fromHSV(hue, 1.0f, suspect ? 0.5f : 1.0f);
                 } 
                 setPadColor(gridRow, gridCol, padColor);
             }
         }
 
-        // Only send MIDI if the button state has actually changed
         setButtonColorBW(55, layerOffset + 8 < numLayers ? 255 : 0);     // BTN_OCTAVE_UP
         setButtonColorBW(54, layerOffset > 0 ? 255 : 0);   // BTN_OCTAVE_DOWN
         setButtonColorBW(63, columnOffset + 8 < numColumns ? 255 : 0); // BTN_PAGE_RIGHT
         setButtonColorBW(62, columnOffset > 0 ? 255 : 0);  // BTN_PAGE_LEFT
 
-        // Master button (cc28) always white
-        setButtonColorBW(28, 128);
+        // Master button (cc28) white, blinking while in selecting mode
+        if (parentUI->getMode() == PushUI::Mode::Selecting) {
+            setButtonAnimationBW(28, 0, 128, LedAnimation::Blink, LedAnimationRate::Quarter);
+        } else {
+            setButtonColorBW(28, 128);
+        }
 
         //set shift and select buttons to white
         setButtonColorBW(49, 128);
@@ -390,5 +522,7 @@ public:
         // set "setup" and "user" buttons to white
         setButtonColorBW(30, 128);
         setButtonColorBW(59, 128);
+
+        commitFrame();
     }
 };
\ No newline at end of file
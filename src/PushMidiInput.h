@@ -0,0 +1,228 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+#include "LockFreeQueue.h"
+
+// Rename to avoid conflict with RtMidi's MidiMessage.
+// Channel messages (notes, CCs, pitch bend, aftertouch) are stored inline; SysEx points into a
+// pooled buffer that is only valid while the callback runs.
+struct PushMidiMessage {
+    uint8_t bytes[3] = {0, 0, 0};
+    uint8_t length = 0;
+    const uint8_t* sysex = nullptr;
+    uint16_t sysexLength = 0;
+
+    PushMidiMessage() = default;
+
+    // Channel/system message; anything past three bytes is ignored
+    PushMidiMessage(const uint8_t* rawData, size_t size) {
+        length = static_cast<uint8_t>(size < 3 ? size : 3);
+        std::memcpy(bytes, rawData, length);
+    }
+
+    static PushMidiMessage sysEx(const uint8_t* rawData, size_t size) {
+        PushMidiMessage message;
+        message.sysex = rawData;
+        message.sysexLength = static_cast<uint16_t>(size);
+        return message;
+    }
+
+    const uint8_t* data() const { return sysex ? sysex : bytes; }
+    size_t size() const { return sysex ? sysexLength : length; }
+    uint8_t operator[](size_t i) const { return data()[i]; }
+    bool isSysEx() const { return sysex != nullptr; }
+
+    bool isNoteOn() const {
+        return length >= 3 && (bytes[0] & 0xF0) == 0x90 && bytes[2] > 0;
+    }
+    bool isNoteOff() const {
+        return length >= 1 && ((bytes[0] & 0xF0) == 0x80 ||
+               ((bytes[0] & 0xF0) == 0x90 && length >= 3 && bytes[2] == 0));
+    }
+    bool isControlChange() const {
+        return length >= 1 && (bytes[0] & 0xF0) == 0xB0;
+    }
+    bool isPitchBend() const {
+        return length >= 1 && (bytes[0] & 0xF0) == 0xE0;
+    }
+
+    uint8_t getNote() const { return (length >= 2) ? bytes[1] : 0; }
+    uint8_t getVelocity() const { return (length >= 3) ? bytes[2] : 0; }
+    uint8_t getController() const { return (length >= 2) ? bytes[1] : 0; }
+    uint8_t getValue() const { return (length >= 3) ? bytes[2] : 0; }
+    uint16_t getPitchBend() const {
+        if (length >= 3) {
+            // Combine LSB and MSB to get 14-bit pitch bend value
+            return static_cast<uint16_t>(bytes[1]) | (static_cast<uint16_t>(bytes[2]) << 7);
+        }
+        return 8192; // Center value
+    }
+};
+
+// Fixed set of SysEx buffers shared between the MIDI input thread and the dispatcher
+template <size_t SlotCount, size_t SlotSize>
+class SysExPool {
+private:
+    struct alignas(64) Slot {
+        std::atomic<bool> inUse{false};
+        uint8_t data[SlotSize];
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<size_t> nextSlot{0};
+
+public:
+    static constexpr size_t SLOT_SIZE = SlotSize;
+
+    SysExPool() : slots(new Slot[SlotCount]) {}
+
+    // Copy a message into a free slot; returns the slot index, or -1 if it is too big or the pool is exhausted
+    int acquire(const uint8_t* data, size_t size) {
+        if (size > SlotSize) return -1;
+        for (size_t attempt = 0; attempt < SlotCount; ++attempt) {
+            size_t index = nextSlot.fetch_add(1, std::memory_order_relaxed) % SlotCount;
+            if (!slots[index].inUse.exchange(true, std::memory_order_acquire)) {
+                std::memcpy(slots[index].data, data, size);
+                return static_cast<int>(index);
+            }
+        }
+        return -1;
+    }
+
+    const uint8_t* slotData(int index) const { return slots[index].data; }
+
+    void release(int index) {
+        slots[index].inUse.store(false, std::memory_order_release);
+    }
+};
+
+// Moves MIDI input off the driver's callback thread. post() copies the message into a
+// preallocated queue slot (SysEx into a pooled buffer) and returns; the dispatcher thread
+// runs the user callback. Nothing on this path allocates.
+class PushMidiDispatcher {
+public:
+    using Callback = std::function<void(const PushMidiMessage&)>;
+    using SysExHandler = std::function<bool(const PushMidiMessage&)>;
+
+private:
+    struct QueuedMidi {
+        PushMidiMessage message;
+        int16_t sysexSlot = -1;
+        bool stop = false;
+    };
+    static constexpr size_t QUEUE_CAPACITY = 512;
+
+    BoundedMPSCQueue<QueuedMidi, QUEUE_CAPACITY> queue;
+    std::counting_semaphore<QUEUE_CAPACITY + 1> pending{0};
+    SysExPool<128, 512> sysexPool;   // room for a full palette readback in flight
+
+    // Held while the callback runs, so swapping it never races a call in progress
+    std::mutex callbackMutex;
+    Callback callback;
+
+    // Sees SysEx before the callback; messages it returns true for are not passed on
+    SysExHandler sysexHandler;
+
+    std::thread dispatchThread;
+
+    std::atomic<uint64_t> messagesReceived{0};
+    std::atomic<uint64_t> messagesDropped{0};
+    std::atomic<uint64_t> sysexDropped{0};
+
+    bool push(const QueuedMidi& item) {
+        if (!queue.tryPush(item)) return false;
+        pending.release();
+        return true;
+    }
+
+    void dispatchLoop() {
+        for (;;) {
+            pending.acquire();
+            QueuedMidi item;
+            while (!queue.tryPop(item)) {
+                std::this_thread::yield(); // claimed by the producer but not yet written
+            }
+            if (item.stop) break;
+
+            bool handled = false;
+            if (item.sysexSlot >= 0) {
+                item.message.sysex = sysexPool.slotData(item.sysexSlot);
+                handled = sysexHandler && sysexHandler(item.message);
+            }
+            if (!handled) {
+                std::lock_guard<std::mutex> lock(callbackMutex);
+                if (callback) callback(item.message);
+            }
+            if (item.sysexSlot >= 0) {
+                sysexPool.release(item.sysexSlot);
+            }
+        }
+    }
+
+public:
+    PushMidiDispatcher() {
+        dispatchThread = std::thread(&PushMidiDispatcher::dispatchLoop, this);
+    }
+
+    ~PushMidiDispatcher() {
+        QueuedMidi stop;
+        stop.stop = true;
+        while (!push(stop)) {
+            std::this_thread::yield();
+        }
+        if (dispatchThread.joinable()) {
+            dispatchThread.join();
+        }
+    }
+
+    PushMidiDispatcher(const PushMidiDispatcher&) = delete;
+    PushMidiDispatcher& operator=(const PushMidiDispatcher&) = delete;
+
+    // Called on the MIDI driver thread
+    void post(const uint8_t* data, size_t size) {
+        if (size == 0) return;
+        messagesReceived.fetch_add(1, std::memory_order_relaxed);
+
+        QueuedMidi item;
+        if (data[0] == 0xF0) {
+            int slot = sysexPool.acquire(data, size);
+            if (slot < 0) {
+                sysexDropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            item.sysexSlot = static_cast<int16_t>(slot);
+            item.message.sysexLength = static_cast<uint16_t>(size);
+        } else {
+            item.message = PushMidiMessage(data, size);
+        }
+
+        if (!push(item)) {
+            if (item.sysexSlot >= 0) sysexPool.release(item.sysexSlot);
+            messagesDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void setCallback(Callback newCallback) {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        callback = std::move(newCallback);
+    }
+
+    // Set once, before any input arrives
+    void setSysExHandler(SysExHandler handler) {
+        sysexHandler = std::move(handler);
+    }
+
+    uint64_t getMessagesReceived() const { return messagesReceived.load(); }
+    uint64_t getMessagesDropped() const { return messagesDropped.load(); }
+    uint64_t getSysExDropped() const { return sysexDropped.load(); }
+    size_t getQueueDepth() const { return queue.sizeApprox(); }
+};
@@ -0,0 +1,375 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <iostream>
+
+// Which MIDI output goes first once the output budget is used up
+enum class MidiPriority : uint8_t {
+    Feedback = 0,   // LEDs the performer just touched, the touch strip, palette entries
+    Repaint = 1     // everything else: navigation, full refreshes
+};
+
+// Paces MIDI output to the Push to a byte budget per millisecond (a token bucket that can save up
+// BURST_MS worth while idle). While there is budget, messages are written right away on the caller's
+// thread, so an ordinary frame costs nothing extra. Beyond it they queue per priority class and a
+// sender thread drains them as the budget refills, feedback first.
+// A queued message for an LED is dropped when a newer message for the same LED is sent at the same
+// or a higher priority, so a backlog never spends the budget on stale colours and a late repaint
+// never overwrites newer feedback. An animation and the channel 1 colour it starts from count as one.
+// While held (PushUSB::MidiBatch) everything is queued and goes out on release in as few writes as
+// the backend allows: ALSA and CoreMIDI parse a byte stream of several messages, WinMM only takes
+// one short message (or one SysEx) per call.
+class PushMidiShaper {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Writer = std::function<bool(const uint8_t* data, size_t size)>;  // one backend write
+
+    static constexpr int CLASSES = 2;
+    static constexpr double DEFAULT_BYTES_PER_MS = 32.0;
+    static constexpr int BURST_MS = 16;
+    static constexpr size_t WRITE_CAPACITY = 4096;
+    static constexpr size_t COMPACT_MIN = 256;  // queue entries before dropped ones are squeezed out
+
+private:
+    static constexpr int32_t NO_LED = -1;
+    static constexpr int32_t TOUCH_STRIP_LED = 0x10000;
+
+    struct Message {
+        uint32_t offset;
+        uint32_t size;
+        int32_t led;
+        Clock::time_point queuedAt;
+        bool dropped;
+        bool animation;     // channel 2-16: follows the channel 1 colour it starts from
+    };
+
+    // FIFO of one priority class; storage is reused once it drains, so steady state does not allocate
+    struct Queue {
+        std::vector<uint8_t> bytes;
+        std::vector<Message> messages;
+        size_t next = 0;
+
+        // Statistics
+        uint64_t sent = 0;
+        uint64_t waited = 0;        // had to wait for budget
+        uint64_t superseded = 0;
+        double totalDelayMs = 0.0;
+        double worstDelayMs = 0.0;
+
+        bool empty() const { return next == messages.size(); }
+
+        void skipDropped() {
+            while (next < messages.size() && messages[next].dropped) next++;
+            if (empty()) {
+                bytes.clear();
+                messages.clear();
+                next = 0;
+            }
+        }
+
+        // Squeeze out sent and dropped messages, so a queue that never quite drains stays bounded
+        void compact() {
+            size_t kept = 0;
+            size_t keptBytes = 0;
+            for (size_t i = next; i < messages.size(); ++i) {
+                Message message = messages[i];
+                if (message.dropped) continue;
+                std::memmove(bytes.data() + keptBytes, bytes.data() + message.offset, message.size);
+                message.offset = static_cast<uint32_t>(keptBytes);
+                keptBytes += message.size;
+                messages[kept++] = message;
+            }
+            messages.resize(kept);
+            bytes.resize(keptBytes);
+            next = 0;
+        }
+    };
+
+    Writer writer;
+    bool acceptsStreams = false;
+
+    std::mutex shaperMutex;
+    std::condition_variable shaperCondition;
+    std::thread senderThread;
+    bool shouldStop = false;
+    int holdDepth = 0;
+
+    Queue queues[CLASSES];
+    double bytesPerMs = DEFAULT_BYTES_PER_MS;   // 0 = unlimited
+    double tokens = DEFAULT_BYTES_PER_MS * BURST_MS;
+    Clock::time_point lastRefill = Clock::now();
+
+    uint8_t writeBuffer[WRITE_CAPACITY];
+    size_t writeSize = 0;
+    bool lastWriteOk = true;
+
+    static const char* className(int c) {
+        return c == static_cast<int>(MidiPriority::Feedback) ? "feedback" : "repaint";
+    }
+
+    static bool isAnimation(const uint8_t* data, size_t size) {
+        return size == 3 && (data[0] & 0xF0) != 0xF0 && (data[0] & 0x0F) != 0;
+    }
+
+    // Note and CC messages address one LED; the touch strip SysEx replaces all of its LEDs
+    static int32_t ledFor(const uint8_t* data, size_t size) {
+        if (size == 3 && ((data[0] & 0xF0) == 0x90 || (data[0] & 0xF0) == 0xB0)) {
+            return ((data[0] & 0xF0) << 8) | data[1];
+        }
+        if (size > 7 && data[0] == 0xF0 && data[6] == 0x19) return TOUCH_STRIP_LED;
+        return NO_LED;
+    }
+
+    double burstBytes() const { return bytesPerMs * BURST_MS; }
+
+    // Caller must hold shaperMutex
+    void refillLocked(Clock::time_point now) {
+        if (bytesPerMs > 0.0) {
+            double elapsedMs = std::chrono::duration<double, std::milli>(now - lastRefill).count();
+            tokens = std::min(burstBytes(), tokens + elapsedMs * bytesPerMs);
+        }
+        lastRefill = now;
+    }
+
+    // Caller must hold shaperMutex
+    void writeLocked(const uint8_t* data, size_t size) {
+        if (size == 0) return;
+        lastWriteOk = writer(data, size) && lastWriteOk;
+    }
+
+    // Caller must hold shaperMutex
+    void flushWriteBufferLocked() {
+        writeLocked(writeBuffer, writeSize);
+        writeSize = 0;
+    }
+
+    // Caller must hold shaperMutex
+    void supersedeLocked(int32_t led, int priority, bool animation) {
+        if (led == NO_LED) return;
+        // Touch strip updates replace each other at any priority; single LEDs at this one and below
+        int first = led == TOUCH_STRIP_LED ? 0 : priority;
+        for (int c = first; c < CLASSES; ++c) {
+            Queue& queue = queues[c];
+            size_t live = 0;
+            for (size_t i = queue.next; i < queue.messages.size(); ++i) {
+                Message& message = queue.messages[i];
+                if (message.dropped) continue;
+                // An animation keeps the channel 1 colour queued just before it in its own class
+                bool partner = animation && c == priority && !message.animation;
+                if (message.led == led && !partner) {
+                    message.dropped = true;
+                    queue.superseded++;
+                } else {
+                    live++;
+                }
+            }
+            queue.skipDropped();
+            if (queue.messages.size() >= COMPACT_MIN && live * 2 < queue.messages.size()) {
+                queue.compact();
+            }
+        }
+    }
+
+    // Write queued messages, highest priority first, while the budget lasts (or all of them);
+    // deferred = they are going out later than the call that queued them. Caller must hold shaperMutex.
+    void drainLocked(bool ignoreBudget, bool deferred) {
+        Clock::time_point now = Clock::now();
+        refillLocked(now);
+        for (;;) {
+            int c = 0;
+            while (c < CLASSES && queues[c].empty()) c++;
+            if (c == CLASSES) break;
+            Queue& queue = queues[c];
+            const Message& message = queue.messages[queue.next];
+
+            // A message bigger than the burst goes once the bucket is full, leaving it in debt
+            if (!ignoreBudget && bytesPerMs > 0.0 && tokens < std::min<double>(message.size, burstBytes())) break;
+            if (bytesPerMs > 0.0) tokens -= message.size;
+
+            const uint8_t* data = queue.bytes.data() + message.offset;
+            if (acceptsStreams && message.size <= WRITE_CAPACITY) {
+                if (writeSize + message.size > WRITE_CAPACITY) flushWriteBufferLocked();
+                std::memcpy(writeBuffer + writeSize, data, message.size);
+                writeSize += message.size;
+            } else {
+                flushWriteBufferLocked();
+                writeLocked(data, message.size);
+            }
+
+            double delayMs = std::chrono::duration<double, std::milli>(now - message.queuedAt).count();
+            queue.sent++;
+            if (deferred) queue.waited++;
+            queue.totalDelayMs += delayMs;
+            queue.worstDelayMs = std::max(queue.worstDelayMs, delayMs);
+            queue.next++;
+            queue.skipDropped();
+        }
+        flushWriteBufferLocked();
+    }
+
+    // Caller must hold shaperMutex
+    bool pendingLocked() const {
+        for (const Queue& queue : queues) {
+            if (!queue.empty()) return true;
+        }
+        return false;
+    }
+
+    void senderLoop() {
+        std::unique_lock<std::mutex> lock(shaperMutex);
+        while (!shouldStop) {
+            if (holdDepth > 0 || !pendingLocked()) {
+                shaperCondition.wait(lock);
+                continue;
+            }
+            drainLocked(false, true);
+            if (!pendingLocked()) continue;
+
+            // Sleep until the bucket holds the next message, and at least a millisecond's budget so
+            // the backlog goes out in a few larger writes rather than one per message
+            int c = 0;
+            while (queues[c].empty()) c++;
+            double size = std::max<double>(queues[c].messages[queues[c].next].size, bytesPerMs);
+            double needed = std::min(size, burstBytes()) - tokens;
+            auto wait = std::chrono::duration<double, std::milli>(std::max(needed, 1.0) / bytesPerMs);
+            shaperCondition.wait_for(lock, std::chrono::duration_cast<Clock::duration>(wait));
+        }
+    }
+
+public:
+    explicit PushMidiShaper(Writer write) : writer(std::move(write)) {
+        senderThread = std::thread(&PushMidiShaper::senderLoop, this);
+    }
+
+    ~PushMidiShaper() {
+        {
+            std::lock_guard<std::mutex> lock(shaperMutex);
+            shouldStop = true;
+        }
+        shaperCondition.notify_all();
+        if (senderThread.joinable()) {
+            senderThread.join();
+        }
+    }
+
+    PushMidiShaper(const PushMidiShaper&) = delete;
+    PushMidiShaper& operator=(const PushMidiShaper&) = delete;
+
+    void setAcceptsStreams(bool streams) {
+        std::lock_guard<std::mutex> lock(shaperMutex);
+        acceptsStreams = streams;
+    }
+
+    // Output budget in bytes per millisecond; 0 = unlimited
+    void setBudget(double budgetBytesPerMs) {
+        {
+            std::lock_guard<std::mutex> lock(shaperMutex);
+            bytesPerMs = std::max(0.0, budgetBytesPerMs);
+            tokens = burstBytes();
+            lastRefill = Clock::now();
+        }
+        shaperCondition.notify_all();
+    }
+
+    double getBudget() {
+        std::lock_guard<std::mutex> lock(shaperMutex);
+        return bytesPerMs;
+    }
+
+    // Queue everything until the matching release()
+    void hold() {
+        std::lock_guard<std::mutex> lock(shaperMutex);
+        holdDepth++;
+    }
+
+    // ignoreBudget: write everything queued at once (restoring a reattached device); the bytes
+    // still count against the budget
+    bool release(bool ignoreBudget = false) {
+        bool success;
+        {
+            std::lock_guard<std::mutex> lock(shaperMutex);
+            if (holdDepth == 0 || --holdDepth > 0) return true;
+            lastWriteOk = true;
+            drainLocked(ignoreBudget, false);
+            success = lastWriteOk;
+        }
+        shaperCondition.notify_one();
+        return success;
+    }
+
+    // Send one complete MIDI message; false if a write it caused failed
+    bool send(const uint8_t* data, size_t size, MidiPriority priority) {
+        bool success = true;
+        {
+            std::lock_guard<std::mutex> lock(shaperMutex);
+            int c = static_cast<int>(priority);
+            int32_t led = ledFor(data, size);
+            bool animation = isAnimation(data, size);
+            supersedeLocked(led, c, animation);
+
+            Queue& queue = queues[c];
+            Message message{static_cast<uint32_t>(queue.bytes.size()), static_cast<uint32_t>(size), led, Clock::now(), false, animation};
+            queue.bytes.insert(queue.bytes.end(), data, data + size);
+            queue.messages.push_back(message);
+            if (holdDepth > 0) return true;
+
+            lastWriteOk = true;
+            drainLocked(false, false);
+            success = lastWriteOk;
+            if (!pendingLocked()) return success;
+        }
+        shaperCondition.notify_one();
+        return success;
+    }
+
+    // Write everything queued, then this message, regardless of the budget (for requests
+    // that wait for a reply); the bytes still count against the budget
+    bool sendNow(const uint8_t* data, size_t size) {
+        std::lock_guard<std::mutex> lock(shaperMutex);
+        lastWriteOk = true;
+        drainLocked(true, true);
+        if (bytesPerMs > 0.0) tokens -= static_cast<double>(size);
+        writeLocked(data, size);
+        return lastWriteOk;
+    }
+
+    // Drop everything queued (the device went away)
+    void clear() {
+        std::lock_guard<std::mutex> lock(shaperMutex);
+        for (Queue& queue : queues) {
+            queue.bytes.clear();
+            queue.messages.clear();
+            queue.next = 0;
+        }
+        writeSize = 0;
+    }
+
+    void printStats() {
+        std::lock_guard<std::mutex> lock(shaperMutex);
+        std::cout << "MIDI output budget: ";
+        if (bytesPerMs > 0.0) {
+            std::cout << bytesPerMs << " bytes/ms, burst " << burstBytes() << " bytes" << std::endl;
+        } else {
+            std::cout << "unlimited" << std::endl;
+        }
+        for (int c = 0; c < CLASSES; ++c) {
+            const Queue& queue = queues[c];
+            std::cout << "  " << className(c) << ": " << queue.sent << " messages, " << queue.waited
+                      << " queued behind the budget, " << queue.superseded << " superseded";
+            if (queue.sent > 0) {
+                std::cout << ", delay mean " << (queue.totalDelayMs / queue.sent) << " ms, worst "
+                          << queue.worstDelayMs << " ms";
+            }
+            std::cout << ", " << (queue.messages.size() - queue.next) << " pending" << std::endl;
+        }
+    }
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+
+#include "PushUSB.h"
+
+// Shadow of the Push 2's 128-entry LED colour palette.
+// Callers state the colour they want for an index as often as they like; flush() sends only
+// entries that differ from what the device already has, followed by a single reapply.
+// Nothing is sent while the palette is unchanged.
+class PushPalette {
+public:
+    struct Entry {
+        uint8_t r = 0, g = 0, b = 0, w = 0;
+
+        bool operator==(const Entry& other) const {
+            return r == other.r && g == other.g && b == other.b && w == other.w;
+        }
+        bool operator!=(const Entry& other) const { return !(*this == other); }
+    };
+
+    static constexpr int SIZE = 128;
+
+private:
+    PushUSB& pushDevice;
+    Entry desired[SIZE];
+    Entry onDevice[SIZE];
+    bool deviceKnown[SIZE];     // false until we've written the entry (device defaults are unknown)
+    bool used[SIZE];            // set() was called for this index at least once
+    bool dirty[SIZE];
+    bool anyDirty = false;
+
+    // Statistics
+    uint64_t entriesSent = 0;
+    uint64_t reapplies = 0;
+
+public:
+    explicit PushPalette(PushUSB& push) : pushDevice(push) {
+        for (int i = 0; i < SIZE; ++i) {
+            used[i] = false;
+            deviceKnown[i] = false;
+            dirty[i] = false;
+        }
+    }
+
+    void set(uint8_t index, const Entry& entry) {
+        if (index >= SIZE) return;
+        desired[index] = entry;
+        used[index] = true;
+        bool differs = !deviceKnown[index] || onDevice[index] != entry;
+        dirty[index] = differs;
+        anyDirty |= differs;
+    }
+
+    const Entry& get(uint8_t index) const { return desired[index & (SIZE - 1)]; }
+
+    // Send changed entries and one reapply; returns the number of entries sent
+    int flush() {
+        if (!anyDirty) return 0;
+        PushUSB::MidiBatch batch(pushDevice);
+        int sent = 0;
+        for (int i = 0; i < SIZE; ++i) {
+            if (!dirty[i]) continue;
+            const Entry& entry = desired[i];
+            pushDevice.setPaletteEntry(static_cast<uint8_t>(i), entry.r, entry.g, entry.b, entry.w, false);
+            onDevice[i] = entry;
+            deviceKnown[i] = true;
+            dirty[i] = false;
+            sent++;
+        }
+        anyDirty = false;
+        if (sent > 0) {
+            pushDevice.reapplyPalette();
+            entriesSent += sent;
+            reapplies++;
+        }
+        return sent;
+    }
+
+    // Forget what the device holds (reconnect, forced refresh); the next flush resends every entry that was set
+    void invalidate() {
+        for (int i = 0; i < SIZE; ++i) {
+            deviceKnown[i] = false;
+            dirty[i] = used[i];
+            anyDirty |= used[i];
+        }
+    }
+
+    uint64_t getEntriesSent() const { return entriesSent; }
+    uint64_t getReapplies() const { return reapplies; }
+
+    void printStats() const {
+        int inUse = 0;
+        for (int i = 0; i < SIZE; ++i) inUse += used[i] ? 1 : 0;
+        std::cout << "Palette: " << inUse << " entries in use, " << entriesSent << " entries sent, "
+                  << reapplies << " reapplies" << std::endl;
+    }
+};
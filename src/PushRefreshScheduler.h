@@ -0,0 +1,269 @@
+#pragma once
+
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdint>
+
+// Timestamps of the stages of one frame, filled in by the render function
+class PushFrameStages {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr int MAX_STAGES = 4;
+
+    struct Stage {
+        const char* name = nullptr;
+        double ms = 0.0;
+    };
+
+private:
+    Stage stages[MAX_STAGES];
+    int stageCount = 0;
+    Clock::time_point stageStart;
+
+public:
+    // Ends the current stage, if any, and starts the next; name must be a string literal
+    void begin(const char* name) {
+        end();
+        if (stageCount >= MAX_STAGES) return;
+        stages[stageCount].name = name;
+        stages[stageCount].ms = -1.0; // running
+        stageStart = Clock::now();
+        stageCount++;
+    }
+
+    void end() {
+        if (stageCount == 0 || stages[stageCount - 1].ms >= 0.0) return;
+        stages[stageCount - 1].ms = std::chrono::duration<double, std::milli>(Clock::now() - stageStart).count();
+    }
+
+    int count() const { return stageCount; }
+    const Stage& operator[](int i) const { return stages[i]; }
+};
+
+// Redraws the Push when something changed instead of on a fixed tick.
+// Tracker changes and user input mark the LED and display pipelines dirty. Each pipeline has its
+// own thread, rate cap and deadline, so a slow USB display frame never holds up pad feedback.
+// A frame's deadline is one period after it became due; finishing later counts as an overrun.
+// Latency is measured from the first change a frame picks up to the end of that frame.
+class PushRefreshScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Render = std::function<void(PushFrameStages&)>;
+
+    // A clip counts as playing until 100 ms after its last transport update, so redraw once that has lapsed
+    static constexpr int TRAILING_REFRESH_MS = 110;
+    // The Push 2 blanks its display when it gets no frame for 2 s
+    static constexpr int DISPLAY_KEEPALIVE_MS = 1000;
+
+private:
+    class Pipeline {
+        struct StageStats {
+            const char* name = nullptr;
+            double totalMs = 0.0;
+            double worstMs = 0.0;
+        };
+
+        std::string name;
+        Render render;
+        Clock::duration period{};
+        int keepaliveMs = 0;            // 0 = never redraw without a change
+
+        std::mutex pipelineMutex;
+        std::condition_variable pipelineCondition;
+        std::thread pipelineThread;
+        bool shouldStop = false;
+
+        bool dirty = false;
+        Clock::time_point dirtySince;
+        Clock::time_point trailingAt = Clock::time_point::max();
+        Clock::time_point lastFrame;
+
+        // Statistics
+        uint64_t frames = 0;
+        uint64_t changes = 0;
+        uint64_t overruns = 0;
+        double worstLatencyMs = 0.0;
+        double totalLatencyMs = 0.0;
+        uint64_t latencySamples = 0;
+        double worstFrameMs = 0.0;
+        StageStats stageStats[PushFrameStages::MAX_STAGES];
+
+        // Caller must hold pipelineMutex
+        Clock::time_point nextDue() const {
+            Clock::time_point due = Clock::time_point::max();
+            if (dirty) due = std::max(dirtySince, lastFrame + period);
+            if (trailingAt != Clock::time_point::max()) due = std::min(due, std::max(trailingAt, lastFrame + period));
+            if (keepaliveMs > 0) due = std::min(due, lastFrame + std::chrono::milliseconds(keepaliveMs));
+            return due;
+        }
+
+        // Caller must hold pipelineMutex
+        void recordStages(const PushFrameStages& stages) {
+            for (int i = 0; i < stages.count(); ++i) {
+                int slot = 0;
+                while (slot < PushFrameStages::MAX_STAGES && stageStats[slot].name &&
+                       std::strcmp(stageStats[slot].name, stages[i].name) != 0) {
+                    slot++;
+                }
+                if (slot == PushFrameStages::MAX_STAGES) continue;
+                stageStats[slot].name = stages[i].name;
+                stageStats[slot].totalMs += stages[i].ms;
+                stageStats[slot].worstMs = std::max(stageStats[slot].worstMs, stages[i].ms);
+            }
+        }
+
+        void pipelineLoop() {
+            std::unique_lock<std::mutex> lock(pipelineMutex);
+            while (!shouldStop) {
+                Clock::time_point due = nextDue();
+                if (due == Clock::time_point::max()) {
+                    pipelineCondition.wait(lock);
+                    continue;
+                }
+                auto now = Clock::now();
+                if (due > now) {
+                    pipelineCondition.wait_until(lock, due);
+                    continue;
+                }
+
+                // Changes arriving while the frame renders make the pipeline dirty again
+                bool wasDirty = dirty;
+                Clock::time_point changedAt = dirtySince;
+                Clock::time_point deadline = period > Clock::duration::zero() ? due + period : Clock::time_point::max();
+                dirty = false;
+                if (trailingAt <= now) trailingAt = Clock::time_point::max();
+                lastFrame = now;
+
+                lock.unlock();
+                PushFrameStages stages;
+                render(stages);
+                stages.end();
+                auto finished = Clock::now();
+                lock.lock();
+
+                frames++;
+                if (finished > deadline) overruns++;
+                worstFrameMs = std::max(worstFrameMs, std::chrono::duration<double, std::milli>(finished - now).count());
+                recordStages(stages);
+                if (wasDirty) {
+                    double latencyMs = std::chrono::duration<double, std::milli>(finished - changedAt).count();
+                    worstLatencyMs = std::max(worstLatencyMs, latencyMs);
+                    totalLatencyMs += latencyMs;
+                    latencySamples++;
+                }
+            }
+        }
+
+    public:
+        Pipeline(const std::string& pipelineName, double maxRateHz, int keepalive)
+            : name(pipelineName), keepaliveMs(keepalive) {
+            if (maxRateHz > 0.0) {
+                period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / maxRateHz));
+            }
+        }
+
+        ~Pipeline() {
+            stop();
+        }
+
+        void start(Render renderFrame) {
+            {
+                std::lock_guard<std::mutex> lock(pipelineMutex);
+                render = std::move(renderFrame);
+                dirty = true;
+                dirtySince = Clock::now();
+                lastFrame = dirtySince - period;
+            }
+            pipelineThread = std::thread(&Pipeline::pipelineLoop, this);
+        }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(pipelineMutex);
+                shouldStop = true;
+            }
+            pipelineCondition.notify_all();
+            if (pipelineThread.joinable()) {
+                pipelineThread.join();
+            }
+        }
+
+        void markDirty(Clock::time_point now, bool trailing) {
+            {
+                std::lock_guard<std::mutex> lock(pipelineMutex);
+                if (!dirty) {
+                    dirty = true;
+                    dirtySince = now;
+                }
+                changes++;
+                if (trailing) trailingAt = now + std::chrono::milliseconds(TRAILING_REFRESH_MS);
+            }
+            pipelineCondition.notify_one();
+        }
+
+        void printStats() {
+            std::lock_guard<std::mutex> lock(pipelineMutex);
+            double rate = period > Clock::duration::zero() ? 1.0 / std::chrono::duration<double>(period).count() : 0.0;
+            std::cout << name << " pipeline: " << frames << " frames for " << changes << " changes, cap "
+                      << (rate > 0.0 ? std::to_string(static_cast<int>(rate)) + " Hz" : std::string("none"))
+                      << ", " << overruns << " deadline overruns, worst frame " << worstFrameMs << " ms";
+            if (latencySamples > 0) {
+                std::cout << ", latency mean " << (totalLatencyMs / latencySamples) << " ms, worst " << worstLatencyMs << " ms";
+            }
+            std::cout << std::endl;
+            if (frames == 0) return;
+            for (const auto& stage : stageStats) {
+                if (!stage.name) break;
+                std::cout << "  " << stage.name << ": mean " << (stage.totalMs / frames) << " ms, worst "
+                          << stage.worstMs << " ms" << std::endl;
+            }
+        }
+    };
+
+    Pipeline leds;
+    Pipeline display;
+
+public:
+    PushRefreshScheduler(double maxLedRateHz = 120.0, double maxDisplayRateHz = 30.0)
+        : leds("LED", maxLedRateHz, 0), display("Display", maxDisplayRateHz, DISPLAY_KEEPALIVE_MS) {}
+
+    PushRefreshScheduler(const PushRefreshScheduler&) = delete;
+    PushRefreshScheduler& operator=(const PushRefreshScheduler&) = delete;
+
+    // Start both pipelines; each draws once right away
+    void start(Render renderLeds, Render renderDisplay) {
+        leds.start(std::move(renderLeds));
+        display.start(std::move(renderDisplay));
+    }
+
+    void stop() {
+        leds.stop();
+        display.stop();
+    }
+
+    // The tracker state changed; also redraws once more after clips have had time to stop playing
+    void notifyStateChanged() {
+        auto now = Clock::now();
+        leds.markDirty(now, true);
+        display.markDirty(now, true);
+    }
+
+    // User input or anything else that changes what the Push should show
+    void requestRefresh() {
+        auto now = Clock::now();
+        leds.markDirty(now, false);
+        display.markDirty(now, false);
+    }
+
+    void printStats() {
+        leds.printStats();
+        display.printStats();
+    }
+};
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <iostream>
+#include <algorithm>
+
+#include "PushMidiInput.h"
+
+// Request/response layer for Push 2 SysEx commands (F0 00 21 1D 01 01 <command> ... F7).
+// A request is keyed by its command and, for indexed commands, its first argument; the reply
+// carries the same two bytes, so any number of requests can be in flight at once and replies are
+// matched in whatever order they arrive. A request for a key that is already in flight just adds
+// its callback. Replies are taken off the MIDI dispatcher before the user callback sees them;
+// requests that get no reply within their timeout complete with no data.
+class PushSysExTransactions {
+public:
+    using Clock = std::chrono::steady_clock;
+    // data is the whole reply message, nullptr on timeout; valid only during the call
+    using Reply = std::function<void(const uint8_t* data, size_t size)>;
+    using Sender = std::function<bool(const uint8_t* data, size_t size)>;
+
+    static constexpr uint8_t NO_INDEX = 0xFF;
+    static constexpr size_t MAX_IN_FLIGHT = 128; // a whole palette
+    static constexpr int DEFAULT_TIMEOUT_MS = 100;
+
+private:
+    static constexpr uint8_t HEADER[6] = {0xF0, 0x00, 0x21, 0x1D, 0x01, 0x01};
+
+    struct Request {
+        std::vector<uint8_t> message;
+        std::vector<Reply> replies;
+        int timeoutMs = DEFAULT_TIMEOUT_MS;
+        Clock::time_point deadline;
+        bool sent = false;
+    };
+
+    Sender sender;
+
+    mutable std::mutex requestMutex;
+    std::condition_variable timeoutCondition;
+    std::unordered_map<uint16_t, Request> requests;
+    std::deque<uint16_t> waiting;   // not sent yet because MAX_IN_FLIGHT were outstanding
+    size_t inFlight = 0;
+    bool shouldStop = false;
+    std::thread timeoutThread;
+
+    std::atomic<uint64_t> requestsSent{0};
+    std::atomic<uint64_t> repliesMatched{0};
+    std::atomic<uint64_t> timeouts{0};
+
+    static uint16_t keyFor(uint8_t command, uint8_t index) {
+        return static_cast<uint16_t>((command << 8) | index);
+    }
+
+    // Caller must hold requestMutex
+    void sendLocked(Request& request) {
+        request.sent = true;
+        request.deadline = Clock::now() + std::chrono::milliseconds(request.timeoutMs);
+        inFlight++;
+        requestsSent++;
+        sender(request.message.data(), request.message.size());
+        timeoutCondition.notify_one();
+    }
+
+    // Caller must hold requestMutex
+    void sendWaitingLocked() {
+        while (inFlight < MAX_IN_FLIGHT && !waiting.empty()) {
+            auto it = requests.find(waiting.front());
+            waiting.pop_front();
+            if (it != requests.end() && !it->second.sent) {
+                sendLocked(it->second);
+            }
+        }
+    }
+
+    void timeoutLoop() {
+        std::unique_lock<std::mutex> lock(requestMutex);
+        while (!shouldStop) {
+            auto now = Clock::now();
+            auto nextDeadline = Clock::time_point::max();
+            std::vector<Reply> expired;
+            for (auto it = requests.begin(); it != requests.end();) {
+                if (it->second.sent && it->second.deadline <= now) {
+                    for (auto& reply : it->second.replies) expired.push_back(std::move(reply));
+                    it = requests.erase(it);
+                    inFlight--;
+                    timeouts++;
+                    continue;
+                }
+                if (it->second.sent) nextDeadline = std::min(nextDeadline, it->second.deadline);
+                ++it;
+            }
+            if (!expired.empty()) {
+                sendWaitingLocked();
+                lock.unlock();
+                for (auto& reply : expired) reply(nullptr, 0);
+                lock.lock();
+                continue;
+            }
+            if (nextDeadline == Clock::time_point::max()) {
+                timeoutCondition.wait(lock);
+            } else {
+                timeoutCondition.wait_until(lock, nextDeadline);
+            }
+        }
+    }
+
+public:
+    explicit PushSysExTransactions(Sender send) : sender(std::move(send)) {
+        timeoutThread = std::thread(&PushSysExTransactions::timeoutLoop, this);
+    }
+
+    ~PushSysExTransactions() {
+        shutdown();
+    }
+
+    PushSysExTransactions(const PushSysExTransactions&) = delete;
+    PushSysExTransactions& operator=(const PushSysExTransactions&) = delete;
+
+    // Send <command> <args...>; index is the argument the reply echoes back after the command,
+    // or NO_INDEX if the reply only carries the command
+    void request(uint8_t command, uint8_t index, const uint8_t* args, size_t argCount, Reply reply,
+                 int timeoutMs = DEFAULT_TIMEOUT_MS) {
+        std::unique_lock<std::mutex> lock(requestMutex);
+        if (shouldStop) {
+            lock.unlock();
+            reply(nullptr, 0);
+            return;
+        }
+        uint16_t key = keyFor(command, index);
+        auto [it, inserted] = requests.try_emplace(key);
+        it->second.replies.push_back(std::move(reply));
+        if (!inserted) return; // same question already asked
+
+        Request& request = it->second;
+        request.timeoutMs = timeoutMs;
+        request.message.assign(HEADER, HEADER + sizeof(HEADER));
+        request.message.push_back(command);
+        request.message.insert(request.message.end(), args, args + argCount);
+        request.message.push_back(0xF7);
+        if (inFlight < MAX_IN_FLIGHT) {
+            sendLocked(request);
+        } else {
+            waiting.push_back(key);
+        }
+    }
+
+    // Called on the MIDI dispatcher thread for every SysEx message; true if it answered a request
+    bool handleReply(const PushMidiMessage& message) {
+        size_t size = message.size();
+        const uint8_t* data = message.data();
+        if (size < 8) return false;
+        for (size_t i = 0; i < sizeof(HEADER); ++i) {
+            if (data[i] != HEADER[i]) return false;
+        }
+        uint8_t command = data[6];
+
+        std::vector<Reply> replies;
+        {
+            std::lock_guard<std::mutex> lock(requestMutex);
+            auto it = size > 8 ? requests.find(keyFor(command, data[7])) : requests.end();
+            if (it == requests.end()) it = requests.find(keyFor(command, NO_INDEX));
+            if (it == requests.end() || !it->second.sent) return false;
+            replies = std::move(it->second.replies);
+            requests.erase(it);
+            inFlight--;
+            repliesMatched++;
+            sendWaitingLocked();
+        }
+        for (auto& reply : replies) reply(data, size);
+        return true;
+    }
+
+    // Fail everything outstanding and stop the timeout thread
+    void shutdown() {
+        std::vector<Reply> cancelled;
+        {
+            std::lock_guard<std::mutex> lock(requestMutex);
+            if (shouldStop) return;
+            shouldStop = true;
+            for (auto& [key, request] : requests) {
+                for (auto& reply : request.replies) cancelled.push_back(std::move(reply));
+            }
+            requests.clear();
+            waiting.clear();
+            inFlight = 0;
+        }
+        timeoutCondition.notify_all();
+        if (timeoutThread.joinable()) {
+            timeoutThread.join();
+        }
+        for (auto& reply : cancelled) reply(nullptr, 0);
+    }
+
+    void printStats() const {
+        size_t pending;
+        {
+            std::lock_guard<std::mutex> lock(requestMutex);
+            pending = requests.size();
+        }
+        std::cout << "SysEx requests: " << requestsSent.load() << " sent, " << repliesMatched.load() << " answered, "
+                  << timeouts.load() << " timed out, " << pending << " pending" << std::endl;
+    }
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "PushUSB.h"
+
+// Every picture the touch strip meter can show, built once: the 31 LED values and the touch strip
+// SysEx that shows them. A meter is some number of full LEDs from the bottom, plus at most one
+// partly lit LED above them (brightness 1-7), so a level maps to one of STATES entries and an
+// update is a table lookup and one write.
+class PushTouchStripMeter {
+public:
+    static constexpr int LEDS = 31;
+    static constexpr int STEPS = 8;                     // partial LED: none or brightness 1-7
+    static constexpr int STATES = LEDS * STEPS + 1;     // the last one is all 31 LEDs full
+
+private:
+    uint8_t values[STATES][32];
+    uint8_t sysex[STATES][PushUSB::TOUCH_STRIP_SYSEX_SIZE];
+
+public:
+    PushTouchStripMeter() {
+        for (int state = 0; state < STATES; ++state) {
+            int fullLEDs = state / STEPS;
+            int partial = state % STEPS;
+            std::memset(values[state], 0, sizeof(values[state]));
+            std::memset(values[state], 7, fullLEDs);
+            if (fullLEDs < LEDS) values[state][fullLEDs] = static_cast<uint8_t>(partial);
+            PushUSB::encodeTouchStripLEDs(values[state], sysex[state]);
+        }
+    }
+
+    // State for a level (0.0 = off, 1.0 = full)
+    static int stateFor(float level) {
+        level = std::max(0.0f, std::min(1.0f, level));
+        float ledCount = level * static_cast<float>(LEDS);
+        int fullLEDs = std::min(static_cast<int>(ledCount), LEDS);
+        if (fullLEDs == LEDS) return STATES - 1;
+        float remainder = ledCount - fullLEDs;
+        int partial = 0;
+        if (remainder > 0.0f) {
+            // Scale remainder to 1-7 (avoid 0 for partial)
+            partial = std::min(static_cast<int>(remainder * 6.0f + 1.0f), 7);
+        }
+        return fullLEDs * STEPS + partial;
+    }
+
+    const uint8_t* ledValues(int state) const { return values[state]; }
+    const uint8_t* message(int state) const { return sysex[state]; }
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+// Where PushUSB's bytes go: the Push 2's MIDI ports and display bulk endpoint, or a stand-in.
+// Everything above it (batching, shaping, SysEx requests, palette, UI) is the same either way.
+class PushTransport {
+public:
+    // Called with one complete incoming MIDI message, on the transport's own thread
+    using MidiInput = std::function<void(const uint8_t* data, size_t size)>;
+
+    virtual ~PushTransport() = default;
+
+    virtual const char* name() const = 0;
+
+    // false if the transport cannot work at all (e.g. no MIDI API)
+    virtual bool initialize() = 0;
+
+    // Open MIDI in and out; input is delivered to the callback until close()
+    virtual bool openMidi(MidiInput input) = 0;
+    virtual bool openDisplay() = 0;
+    virtual void close() = 0;
+
+    // One MIDI write. With acceptsMidiStreams() it may hold several complete messages,
+    // otherwise exactly one short message or one SysEx.
+    virtual bool writeMidi(const uint8_t* data, size_t size) = 0;
+    virtual bool acceptsMidiStreams() const = 0;
+
+    // One bulk transfer to the display endpoint
+    virtual bool hasDisplay() const = 0;
+    virtual bool writeDisplay(const uint8_t* data, int size, unsigned int timeoutMs) = 0;
+
+    // Hot-plug. isPresent() rescans for the device and is cheap enough to poll. Where the platform
+    // reports plugging and unplugging as it happens, the handler is called (on any thread) so
+    // nobody has to wait for the next rescan.
+    using PlugHandler = std::function<void(bool arrived)>;
+
+    virtual bool isPresent() = 0;
+    // false if there are no plug events here; rescans still work
+    virtual bool watchPlugEvents(PlugHandler handler) = 0;
+    virtual void stopPlugEvents() = 0;
+};
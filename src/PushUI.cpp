@@ -3,19 +3,37 @@
 #include "PushDisplay.h"
 #include <iostream>
 
+// Resolume OSC addresses sent from the Push
+static constexpr OSCAddressTemplate ADDR_CROSSFADER_GROUP("/composition/selectedlayer/crossfadergroup");
+static constexpr OSCAddressTemplate ADDR_USER_BUTTON("/composition/selectedlayer/userbutton");
+static constexpr OSCAddressTemplate ADDR_LAYER_OPACITY("/composition/selectedlayer/video/opacity");
+static constexpr OSCAddressTemplate ADDR_COLUMN_SELECT("/composition/columns/{}/select");
+static constexpr OSCAddressTemplate ADDR_COLUMN_CONNECT("/composition/columns/{}/connect");
+static constexpr OSCAddressTemplate ADDR_LAYER_SELECT("/composition/layers/{}/select");
+static constexpr OSCAddressTemplate ADDR_CLIP_SELECT("/composition/layers/{}/clips/{}/select");
+static constexpr OSCAddressTemplate ADDR_CLIP_CONNECT("/composition/layers/{}/clips/{}/connect");
+static constexpr OSCAddressTemplate ADDR_DECK_SELECT("/composition/decks/{}/select");
+
 PushUI::PushUI(PushUSB& push, ResolumeTracker& tracker, std::shared_ptr<OSCSender> osc)
     : pushDevice(push), resolumeTracker(tracker), oscSender(osc), // Changed to shared_ptr
       columnOffset(0), layerOffset(0),
       lastKnownDeck(-1), trackingInitialized(false),
-      numLayers(0), numColumns(0), mode(Mode::Triggering) // <-- add members for layer/column count
+      numLayers(0), numColumns(0) // <-- add members for layer/column count
 {
     lights = new PushLights(pushDevice);
     display = new PushDisplay(pushDevice);
     lights->setParentUI(this);
     display->setParentUI(this);
+
+    // Touch strip opacity goes through the rate-limited continuous output stage
+    if (oscSender) {
+        continuousOutput = std::make_unique<OSCContinuousOutput>(*oscSender);
+        opacityChannel = continuousOutput->channel(ADDR_LAYER_OPACITY);
+    }
 }
 
 PushUI::~PushUI() {
+    continuousOutput.reset(); // sends any pending final value
     lights->clearAllPads();
     lights->clearAllButtons();
     delete lights;
@@ -23,10 +41,7 @@ PushUI::~PushUI() {
 }
 
 bool PushUI::initialize() {
-    if (!pushDevice.isDeviceConnected()) {
-        std::cerr << "Push device not connected" << std::endl;
-        return false;
-    }
+    // Without a device the UI still tracks everything; it shows up once the Push is (re)attached
     pushDevice.setMidiCallback([this](const PushMidiMessage& msg) {
         this->onMidiMessage(msg);
     });
@@ -37,23 +52,96 @@ bool PushUI::initialize() {
 }
 
 void PushUI::update() {
+    PushFrameStages stages;
+    updateLights(stages);
+    updateDisplay(stages);
+}
+
+void PushUI::updateLights(PushFrameStages& stages) {
     //resolumeTracker.update();
+
+    // The tracker clears itself on a deck change; fetch the new deck's state instead of waiting for it
+    if (syncEngine) {
+        int deck;
+        {
+            auto trackerLock = resolumeTracker.readLock();
+            deck = resolumeTracker.getCurrentDeck();
+        }
+        if (deck != lastKnownDeck) {
+            lastKnownDeck = deck;
+            syncEngine->requestSync(getSyncWindow(), true, "deck change");
+        }
+    }
+
+    stages.begin("lights");
     lights->updateLights();
+
+    // Per-frame bundling: anything deferred during this tick goes out as one datagram
+    stages.begin("osc flush");
+    if (oscSender) {
+        oscSender->flush();
+    }
+}
+
+void PushUI::updateDisplay(PushFrameStages& stages) {
+    stages.begin("draw");
     display->update();
+    stages.begin("capture");
+    display->capture();
+    stages.begin("usb");
     display->sendToDevice();
 }
 
-void PushUI::toggleMode() {
-    if (mode == Mode::Triggering) {
-        mode = Mode::Selecting;
-    } else {
-        mode = Mode::Triggering;
+void PushUI::setContinuousRate(double maxRateHz) {
+    if (continuousOutput) {
+        continuousOutput->setMaxRate(maxRateHz);
     }
+}
+
+void PushUI::setPaletteQuantization(int levels) {
+    lights->setPaletteQuantization(levels);
+}
+
+void PushUI::setSyncEngine(OSCSyncEngine* engine) {
+    syncEngine = engine;
+    auto trackerLock = resolumeTracker.readLock();
+    lastKnownDeck = resolumeTracker.getCurrentDeck(); // the startup sync covers the current deck
+}
+
+OSCSyncWindow PushUI::getSyncWindow(bool includeAdjacent) const {
+    int margin = includeAdjacent ? 1 : 0;     // the engine clamps the lower edge to 1
+    int layer = layerOffset.load();
+    int column = columnOffset.load();
+    OSCSyncWindow window;
+    window.firstLayer = layer + 1 - margin;
+    window.lastLayer = layer + 8 + margin;
+    window.firstColumn = column + 1 - margin;
+    window.lastColumn = column + 8 + margin;
+    return window;
+}
+
+void PushUI::toggleMode() {
+    // Only this thread writes the mode, so one load and one store are enough
+    Mode next = mode.load() == Mode::Triggering ? Mode::Selecting : Mode::Triggering;
+    mode.store(next);
 
-    std::cout << "Mode toggled to: " << (mode == Mode::Triggering ? "Triggering" : "Selecting") << std::endl;
+    std::cout << "Mode toggled to: " << (next == Mode::Triggering ? "Triggering" : "Selecting") << std::endl;
 }
 
 void PushUI::onMidiMessage(const PushMidiMessage& msg) {
+    // LEDs the performer touches now go out ahead of any repaint still queued
+    if (msg.isNoteOn()) {
+        lights->notePadInput(msg.getNote());
+    } else if (msg.isControlChange()) {
+        lights->noteButtonInput(msg.getController());
+    }
+    handleMidiMessage(msg);
+    if (refreshScheduler) {
+        refreshScheduler->requestRefresh();
+    }
+}
+
+void PushUI::handleMidiMessage(const PushMidiMessage& msg) {
     if (msg.isNoteOn()) {
         handlePadPress(msg.getNote(), msg.getVelocity());
     } else if (msg.isPitchBend()) {
@@ -68,33 +156,36 @@ void PushUI::onMidiMessage(const PushMidiMessage& msg) {
             return;
         }
 
-        auto layer = resolumeTracker.getSelectedLayer();
+        int crossfaderGroup = 0;
+        {
+            auto trackerLock = resolumeTracker.readLock();
+            auto layer = resolumeTracker.getSelectedLayer();
+            if (layer) {
+                crossfaderGroup = layer->properties.getInt("crossfadergroup");
+            }
+        }
 
         if (cc == 30 && value > 0) { // Setup button pressed
-            if (layer && layer->properties.getInt("crossfadergroup") == 1) {
+            if (crossfaderGroup == 1) {
                 // Crossfader group A button pressed
-                std::string address = "/composition/selectedlayer/crossfadergroup";
                 if (oscSender) {
-                    oscSender->sendMessage(address, 0);
+                    oscSender->sendMessage(ADDR_CROSSFADER_GROUP, {}, 0, OSCUrgency::Deferred);
                 }
             } else {
-                std::string address = "/composition/selectedlayer/crossfadergroup";
                 if (oscSender) {
-                    oscSender->sendMessage(address, 1);
+                    oscSender->sendMessage(ADDR_CROSSFADER_GROUP, {}, 1, OSCUrgency::Deferred);
                 }
             }
             return;
         } else if (cc == 59 && value > 0) { // User button pressed
-            if (layer && layer->properties.getInt("crossfadergroup") == 2) {
+            if (crossfaderGroup == 2) {
                 // Crossfader group B button pressed
-                std::string address = "/composition/selectedlayer/crossfadergroup";
                 if (oscSender) {
-                    oscSender->sendMessage(address, 0);
+                    oscSender->sendMessage(ADDR_CROSSFADER_GROUP, {}, 0, OSCUrgency::Deferred);
                 }
             } else {
-                std::string address = "/composition/selectedlayer/userbutton";
                 if (oscSender) {
-                    oscSender->sendMessage(address, 2);
+                    oscSender->sendMessage(ADDR_USER_BUTTON, {}, 2, OSCUrgency::Deferred);
                 }
             }
             return;
@@ -103,19 +194,17 @@ void PushUI::onMidiMessage(const PushMidiMessage& msg) {
         // Column buttons
         if (cc >= 20 && cc <= 27 && value > 0) {
             int column = columnOffset + (cc - 20) + 1;
-            if (mode == Mode::Selecting) {
-                std::string address = "/composition/columns/" + std::to_string(column) + "/select";
+            if (mode.load() == Mode::Selecting) {
                 if (oscSender) {
-                    oscSender->sendMessage(address, 1);
+                    oscSender->sendMessage(ADDR_COLUMN_SELECT, {column}, 1, OSCUrgency::Deferred);
                 } else {
-                    std::cout << "Would select: " << address << std::endl;
+                    std::cout << "Would select: " << ADDR_COLUMN_SELECT.toString({column}) << std::endl;
                 }
             } else {
-                std::string address = "/composition/columns/" + std::to_string(column) + "/connect";
                 if (oscSender) {
-                    oscSender->sendMessage(address, 1);
+                    oscSender->sendMessage(ADDR_COLUMN_CONNECT, {column}, 1);
                 } else {
-                    std::cout << "Would trigger: " << address << std::endl;
+                    std::cout << "Would trigger: " << ADDR_COLUMN_CONNECT.toString({column}) << std::endl;
                 }
             }
             return;
@@ -124,11 +213,10 @@ void PushUI::onMidiMessage(const PushMidiMessage& msg) {
         // Layer buttons
         if (cc >= 36 && cc <= 43 && value > 0) {
             int layer = layerOffset + (cc - 36) + 1;
-            std::string address = "/composition/layers/" + std::to_string(layer) + "/select";
             if (oscSender) {
-                oscSender->sendMessage(address, 1);
+                oscSender->sendMessage(ADDR_LAYER_SELECT, {layer}, 1, OSCUrgency::Deferred);
             } else {
-                std::cout << "Would select: " << address << std::endl;
+                std::cout << "Would select: " << ADDR_LAYER_SELECT.toString({layer}) << std::endl;
             }
             return;
         }
@@ -137,9 +225,21 @@ void PushUI::onMidiMessage(const PushMidiMessage& msg) {
     }
 }
 
+// Resend everything; the LED pipeline does it on its own thread, so this is safe from the console
 void PushUI::forceRefresh() {
-    lights->forceRefresh();
-    lights->updateLights();
+    restoreDevice();
+}
+
+// The Push was reattached after being unplugged: redraw it from the cached state right away
+void PushUI::restoreDevice() {
+    lights->requestRestore();
+    if (refreshScheduler) {
+        refreshScheduler->requestRefresh();
+    }
+}
+
+void PushUI::printLightStats() const {
+    lights->printPaletteStats();
 }
 
 void PushUI::handlePadPress(int note, int velocity) {
@@ -150,37 +250,35 @@ void PushUI::handlePadPress(int note, int velocity) {
         int resolumeLayer = gridRow + 1 + layerOffset;
         int resolumeColumn = gridCol + 1 + columnOffset;
         
-        if (mode == Mode::Selecting) {
+        if (mode.load() == Mode::Selecting) {
             // Select the clip
-            std::string address = "/composition/layers/" + std::to_string(resolumeLayer) +
-                                  "/clips/" + std::to_string(resolumeColumn) + "/select";
             if (oscSender) {
-                oscSender->sendMessage(address, velocity ? 1 : 0);
+                oscSender->sendMessage(ADDR_CLIP_SELECT, {resolumeLayer, resolumeColumn}, velocity ? 1 : 0, OSCUrgency::Deferred);
             } else {
-                std::cout << "Would select: " << address << std::endl;
+                std::cout << "Would select: " << ADDR_CLIP_SELECT.toString({resolumeLayer, resolumeColumn}) << std::endl;
             }
         } else {
             // Trigger the clip
-            std::string address = "/composition/layers/" + std::to_string(resolumeLayer) +
-                             "/clips/" + std::to_string(resolumeColumn) + "/connect";
             if (oscSender) {
-                oscSender->sendMessage(address, velocity ? 1 : 0);
+                oscSender->sendMessage(ADDR_CLIP_CONNECT, {resolumeLayer, resolumeColumn}, velocity ? 1 : 0);
             } else {
-                std::cout << "Would trigger: " << address << std::endl;
+                std::cout << "Would trigger: " << ADDR_CLIP_CONNECT.toString({resolumeLayer, resolumeColumn}) << std::endl;
             }
 
             // After triggering the clip, timeout all other clips in the same layer. If done before resolume may still send messages for the clip we tried to stop
-            auto layer = resolumeTracker.getLayer(resolumeLayer);
-            if (layer) {
-                layer->timeoutAllExcept(resolumeColumn);
-            }
+            resolumeTracker.timeoutClipsExcept(resolumeLayer, resolumeColumn);
         }
     }
 }
 
 void PushUI::handleNavigationButtons(int controller, int value) {
-    int columns = resolumeTracker.getColumnCount();
-    int layers = resolumeTracker.getLayerCount();
+    int columns, layers, d;
+    {
+        auto trackerLock = resolumeTracker.readLock();
+        columns = resolumeTracker.getColumnCount();
+        layers = resolumeTracker.getLayerCount();
+        d = resolumeTracker.getCurrentDeck();
+    }
     
     if (value == 0) return;
     if (controller == BTN_OCTAVE_UP && layerOffset + 8 < layers) {
@@ -193,9 +291,11 @@ void PushUI::handleNavigationButtons(int controller, int value) {
         columnOffset--;
     }
 
-    int d = resolumeTracker.getCurrentDeck();
-
-    std::string address;
+    // Scrolling exposes a new adjacent row/column; only addresses not synced yet are queried
+    if (syncEngine && (controller == BTN_OCTAVE_UP || controller == BTN_OCTAVE_DOWN ||
+                       controller == BTN_PAGE_LEFT || controller == BTN_PAGE_RIGHT)) {
+        syncEngine->requestSync(getSyncWindow(), false, "scroll");
+    }
 
     switch (controller) {
         case 49:
@@ -204,18 +304,16 @@ void PushUI::handleNavigationButtons(int controller, int value) {
             //resolumeTracker.clear();
             // send the osc message to change the deck
             if(d <= 1) break; // don't go below deck 1
-            address = "/composition/decks/" + std::to_string(d-1) + "/select";
             if (oscSender) {
-                oscSender->sendMessage(address, 1);
+                oscSender->sendMessage(ADDR_DECK_SELECT, {d - 1}, 1, OSCUrgency::Deferred);
             }
             break;
         case 48:
             //std::cout << "Deck: " << d << std::endl;
             //resolumeTracker.clear();
             // send the osc message to change the deck
-            address = "/composition/decks/" + std::to_string(d+1) + "/select";
             if (oscSender) {
-                oscSender->sendMessage(address, 1);
+                oscSender->sendMessage(ADDR_DECK_SELECT, {d + 1}, 1, OSCUrgency::Deferred);
             }
             break;
     }
@@ -223,7 +321,11 @@ void PushUI::handleNavigationButtons(int controller, int value) {
 
 void PushUI::handleTouchStripPitchBend(uint16_t pitchBendValue) {
     // Check if there's a selected layer
-    int selectedLayer = resolumeTracker.getSelectedLayerId();
+    int selectedLayer;
+    {
+        auto trackerLock = resolumeTracker.readLock();
+        selectedLayer = resolumeTracker.getSelectedLayerId();
+    }
     if (selectedLayer <= 0) {
         return; // No layer selected
     }
@@ -249,9 +351,8 @@ void PushUI::handleTouchStripPitchBend(uint16_t pitchBendValue) {
     opacity = std::max(0.0f, std::min(1.0f, opacity));
     
     // Send OSC message to set layer opacity
-    std::string address = "/composition/selectedlayer/video/opacity";
-    if (oscSender) {
-        oscSender->sendMessage(address, opacity);
+    if (continuousOutput) {
+        continuousOutput->set(opacityChannel, opacity);
     } else {
         std::cout << "Would set layer " << selectedLayer << " opacity to: " << opacity << std::endl;
     }
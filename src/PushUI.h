@@ -11,9 +11,13 @@
 #include <cstdio>
 #include <cstdlib>
 #include <thread>
+#include <atomic>
 #include <iostream>
 
 #include "OSCSender.h"
+#include "OSCContinuousOutput.h"
+#include "OSCSyncEngine.h"
+#include "PushRefreshScheduler.h"
 
 #include "PushUSB.h"
 //#include "ResolumeTrackerREST.h"
@@ -34,8 +38,9 @@ private:
     std::shared_ptr<OSCSender> oscSender; // Changed from unique_ptr
     PushLights* lights;
     PushDisplay* display;
-    int columnOffset;
-    int layerOffset;
+    // Written on the MIDI dispatcher thread; read by the LED pipeline and the OSC loss monitor too
+    std::atomic<int> columnOffset;
+    std::atomic<int> layerOffset;
     int numLayers;  // Total number of layers in the current deck
     int numColumns; // Total number of columns in the current deck
     enum PushControls {
@@ -50,25 +55,48 @@ private:
     int lastKnownDeck;
     bool trackingInitialized;
 
+    // Rate-limited output for the touch strip (and other continuous controls)
+    std::unique_ptr<OSCContinuousOutput> continuousOutput;
+    int opacityChannel = -1;
+
+    // Re-queries Resolume when the deck or the visible window changes
+    OSCSyncEngine* syncEngine = nullptr;
+
+    // Told about input so the Push is redrawn right away
+    PushRefreshScheduler* refreshScheduler = nullptr;
+
     // Add mode enum and member
     enum class Mode {
         Triggering,
         Selecting
     };
-    Mode mode = Mode::Triggering;
+    // Written on the MIDI dispatcher thread; read by the LED and display pipelines too
+    std::atomic<Mode> mode{Mode::Triggering};
 
 public:
     PushUI(PushUSB& push, ResolumeTracker& tracker, std::shared_ptr<OSCSender> osc = nullptr);
     ~PushUI();
     bool initialize();
     void update();
+    void updateLights(PushFrameStages& stages);
+    void updateDisplay(PushFrameStages& stages);
     void onMidiMessage(const PushMidiMessage& msg);
     void forceRefresh();
+    void restoreDevice();
+    void printLightStats() const;
     OSCSender* getOSCSender() const { return oscSender.get(); }
+    OSCContinuousOutput* getContinuousOutput() const { return continuousOutput.get(); }
+    void setContinuousRate(double maxRateHz);
+    void setPaletteQuantization(int levels);
+    void setSyncEngine(OSCSyncEngine* engine);
+    void setRefreshScheduler(PushRefreshScheduler* scheduler) { refreshScheduler = scheduler; }
+
+    // The visible 8x8 grid, by default plus one layer/column on each side
+    OSCSyncWindow getSyncWindow(bool includeAdjacent = true) const;
 
     // Mode accessors
-    Mode getMode() const { return mode; }
-    void setMode(Mode m) { mode = m; }
+    Mode getMode() const { return mode.load(); }
+    void setMode(Mode m) { mode.store(m); }
     void toggleMode();
 
     int getColumnOffset() const { return columnOffset; }
@@ -78,6 +106,7 @@ public:
     ResolumeTracker& getResolumeTracker() { return resolumeTracker; }
 
 private:
+    void handleMidiMessage(const PushMidiMessage& msg);
     void handlePadPress(int note, int velocity);
     void handleNavigationButtons(int controller, int value);
     void handleTouchStripPitchBend(uint16_t pitchBendValue);
@@ -1,290 +1,374 @@
 #pragma once
 
-#include "RtMidi.h"
 #include <vector>
 #include <string>
 #include <functional>
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <shared_mutex>
+#include <memory>
+#include <condition_variable>
 #include <iostream>
 #include <cstring>
 #include <chrono>
 #include <algorithm>
 
-#define NOMINMAX
-#include "libusb.h"
+#include "PushTransport.h"
+#include "PushHardwareTransport.h"
+#include "PushMidiInput.h"
+#include "PushSysEx.h"
+#include "PushMidiShaper.h"
 
-#define ABLETON_VENDOR_ID 0x2982
-#define PUSH2_PRODUCT_ID  0x1967
-
-// Rename to avoid conflict with RtMidi's MidiMessage
-struct PushMidiMessage {
-    std::vector<uint8_t> data;
-    
-    PushMidiMessage(const std::vector<uint8_t>& msg) : data(msg) {}
-    PushMidiMessage(const uint8_t* rawData, size_t size) : data(rawData, rawData + size) {}
-    
-    bool isNoteOn() const { 
-        return !data.empty() && (data[0] & 0xF0) == 0x90 && data.size() >= 3 && data[2] > 0; 
-    }
-    bool isNoteOff() const { 
-        return !data.empty() && ((data[0] & 0xF0) == 0x80 || 
-               ((data[0] & 0xF0) == 0x90 && data.size() >= 3 && data[2] == 0)); 
-    }
-    bool isControlChange() const { 
-        return !data.empty() && (data[0] & 0xF0) == 0xB0; 
-    }
-    bool isPitchBend() const {
-        return !data.empty() && (data[0] & 0xF0) == 0xE0;
-    }
-    
-    uint8_t getNote() const { return (data.size() >= 2) ? data[1] : 0; }
-    uint8_t getVelocity() const { return (data.size() >= 3) ? data[2] : 0; }
-    uint8_t getController() const { return (data.size() >= 2) ? data[1] : 0; }
-    uint8_t getValue() const { return (data.size() >= 3) ? data[2] : 0; }
-    uint16_t getPitchBend() const {
-        if (data.size() >= 3) {
-            // Combine LSB and MSB to get 14-bit pitch bend value
-            return static_cast<uint16_t>(data[1]) | (static_cast<uint16_t>(data[2]) << 7);
-        }
-        return 8192; // Center value
-    }
+// One entry of the Push 2 LED colour palette
+struct PushPaletteColor {
+    uint8_t r = 0, g = 0, b = 0, w = 0;
 };
 
 class PushUSB {
 private:
-    // RtMidi objects
-    std::unique_ptr<RtMidiIn> midiIn;
-    std::unique_ptr<RtMidiOut> midiOut;
+    // The Push itself, or a stand-in
+    std::unique_ptr<PushTransport> transport;
+    // Writes share it; opening and closing the device (hot-plug) take it exclusively
+    std::shared_mutex transportMutex;
     
     std::atomic<bool> isConnected;
-    std::function<void(const PushMidiMessage&)> midiCallback;  // Updated type
 
-    libusb_device_handle* deviceHandle = nullptr;
-    
-    // Static callback for RtMidi (C-style callback required)
-    // This converts RtMidi callbacks to our callback system
-    static void midiInputCallback(double timeStamp, std::vector<unsigned char>* message, void* userData) {
-        PushUSB* pushUSB = static_cast<PushUSB*>(userData);
-        if (pushUSB && pushUSB->midiCallback && !message->empty()) {
-            // Convert RtMidi message to our PushMidiMessage
-            pushUSB->midiCallback(PushMidiMessage(*message));
+    std::atomic<uint64_t> midiOutWrites{0};
+    std::atomic<uint64_t> midiOutMessages{0};
+    std::atomic<uint64_t> midiOutBytes{0};
+    bool midiOutAcceptsStreams = false;
+
+    // One backend write; only called by the shaper, which serializes them
+    bool writeMidi(const uint8_t* data, size_t size) {
+        std::shared_lock<std::shared_mutex> lock(transportMutex);
+        if (!isConnected.load()) {
+            return false;
         }
+        if (!transport->writeMidi(data, size)) {
+            requestRescan(); // the device may have gone
+            return false;
+        }
+        midiOutWrites++;
+        midiOutBytes += size;
+        return true;
     }
-    
-    // Find Push 2 MIDI ports
-    bool findPush2MidiPorts(unsigned int& inputPort, unsigned int& outputPort) {
-        // Check input ports
-        bool foundInput = false, foundOutput = false;
-        
-        unsigned int inputPortCount = midiIn->getPortCount();
-        for (unsigned int i = 0; i < inputPortCount; i++) {
-            std::string portName = midiIn->getPortName(i);
-            if (portName.find("Push 2") != std::string::npos || 
-                portName.find("Ableton Push 2") != std::string::npos) {
-                inputPort = i;
-                foundInput = true;
-                std::cout << "Found Push 2 input port: " << portName << std::endl;
-                break;
+
+    // All output goes through the shaper: batching, byte budget and priorities
+    PushMidiShaper midiShaper{[this](const uint8_t* data, size_t size) {
+        return writeMidi(data, size);
+    }};
+
+    // Outstanding SysEx requests; must outlive the dispatcher that delivers their replies
+    PushSysExTransactions sysexTransactions{[this](const uint8_t* data, size_t size) {
+        return sendMidiBytesNow(data, size);
+    }};
+
+    // Input is queued on the transport's thread and delivered to the callback on the dispatcher thread
+    PushMidiDispatcher midiDispatcher;
+
+    // Hot-plug: a background thread notices the Push going away and reattaches it when it is back.
+    // Plug events (where the transport has them) wake it at once; otherwise it finds out by rescanning.
+    static constexpr int RESCAN_MS = 250;
+    static constexpr int ARRIVAL_RESCAN_MS = 10;    // after a plug event, until the MIDI ports show up
+    static constexpr int ARRIVAL_WINDOW_MS = 5000;
+    static constexpr int DISPLAY_RETRY_MS = 2000;   // display held by another app: don't spam the log
+
+    std::mutex hotplugMutex;
+    std::condition_variable hotplugCondition;
+    std::thread hotplugThread;
+    bool hotplugStopped = false;
+    bool rescanPending = false;
+    bool departed = false;                          // plug event: the device left
+    bool arrivalPending = false;                    // plug event: the device arrived, not reattached yet
+    std::chrono::steady_clock::time_point arrivedAt;
+    bool restoreTimed = false;                      // reattached after a plug event, restore not out yet
+    std::chrono::steady_clock::time_point restoreArrivedAt;
+    std::chrono::steady_clock::time_point lastDisplayAttempt;   // hot-plug thread only
+    bool plugEvents = false;
+    std::function<void()> reattachHandler;
+
+    // Statistics, under hotplugMutex
+    uint64_t removals = 0;
+    uint64_t reattaches = 0;
+    double lastReattachMs = -1.0;                   // plug event to usable; -1 = not measured
+    double worstReattachMs = 0.0;
+
+    void requestRescan() {
+        {
+            std::lock_guard<std::mutex> lock(hotplugMutex);
+            rescanPending = true;
+        }
+        hotplugCondition.notify_one();
+    }
+
+    void notePlugEvent(bool arrived) {
+        {
+            std::lock_guard<std::mutex> lock(hotplugMutex);
+            if (arrived) {
+                arrivalPending = true;
+                arrivedAt = std::chrono::steady_clock::now();
+            } else {
+                departed = true;
             }
+            rescanPending = true;
         }
-        
-        unsigned int outputPortCount = midiOut->getPortCount();
-        for (unsigned int i = 0; i < outputPortCount; i++) {
-            std::string portName = midiOut->getPortName(i);
-            if (portName.find("Push 2") != std::string::npos ||
-                portName.find("Ableton Push 2") != std::string::npos) {
-                outputPort = i;
-                foundOutput = true;
-                std::cout << "Found Push 2 output port: " << portName << std::endl;
-                break;
+        hotplugCondition.notify_one();
+    }
+
+    // Open MIDI, then the display; false if MIDI could not be opened
+    bool attach(bool& displayOpen) {
+        {
+            std::unique_lock<std::shared_mutex> lock(transportMutex);
+            bool midiOpen = transport->openMidi([this](const uint8_t* data, size_t size) {
+                midiDispatcher.post(data, size);
+            });
+            if (!midiOpen) {
+                return false;
             }
+            midiOutAcceptsStreams = transport->acceptsMidiStreams();
+            displayOpen = transport->openDisplay();
         }
-        
-        return foundInput && foundOutput;
+        midiShaper.setAcceptsStreams(midiOutAcceptsStreams);
+        isConnected.store(true);
+        return true;
     }
 
-    static libusb_device_handle* open_push2_device(){
-        int result;
-
-        if ((result = libusb_init(NULL)) < 0) {
-            std::cout << "error: [" << result << "] could not initilialize usblib" << std::endl;
-            return NULL;
+    // One rescan: let go of a device that left, pick up one that is back
+    void checkDevice() {
+        bool left;
+        {
+            std::lock_guard<std::mutex> lock(hotplugMutex);
+            left = departed;
+            departed = false;
         }
+        bool present = transport->isPresent();
 
-        libusb_set_debug(NULL, LIBUSB_LOG_LEVEL_ERROR);
-
-        libusb_device** devices;
-        ssize_t count;
-        count = libusb_get_device_list(NULL, &devices);
-        if (count < 0) {
-            std::cout << "error: [" << count << "] could not get usb device list" << std::endl;
-            return NULL;
+        if (isDeviceConnected()) {
+            if (present && !left) {
+                retryDisplay();
+                return;
+            }
+            disconnect();
+            std::cout << transport->name() << " unplugged, waiting for it to come back" << std::endl;
+            std::lock_guard<std::mutex> lock(hotplugMutex);
+            removals++;
+            return;
         }
 
-        libusb_device* device;
-        libusb_device_handle* device_handle = NULL;
-
-        std::string ErrorMsg;
-
-        // set message in case we get to the end of the list w/o finding a device
-        ErrorMsg = "error: Ableton Push 2 device not found";
+        bool displayOpen = false;
+        if (!present || !attach(displayOpen)) return;
+        lastDisplayAttempt = std::chrono::steady_clock::now();
+        if (reattachHandler) {
+            reattachHandler();
+        }
 
-        for (int i = 0; (device = devices[i]) != NULL; i++) {
-            struct libusb_device_descriptor descriptor;
-            if ((result = libusb_get_device_descriptor(device, &descriptor)) < 0) {
-                ErrorMsg = "error: [" + std::to_string(result) + "] could not get usb device descriptor";
-                continue;
-            }
+        std::lock_guard<std::mutex> lock(hotplugMutex);
+        reattaches++;
+        std::cout << transport->name() << " reattached" << (displayOpen ? "" : " (no display)") << std::endl;
+        // Usable once the restore has actually gone out; see noteRestored()
+        restoreTimed = arrivalPending;
+        restoreArrivedAt = arrivedAt;
+        arrivalPending = false;
+    }
 
-            if (descriptor.bDeviceClass == LIBUSB_CLASS_PER_INTERFACE && descriptor.idVendor == ABLETON_VENDOR_ID && descriptor.idProduct == PUSH2_PRODUCT_ID) {
-                if ((result = libusb_open(device, &device_handle)) < 0) {
-                    ErrorMsg = "error: [" + std::to_string(result) + "] could not open Ableton Push 2 device";
-                } else if ((result = libusb_claim_interface(device_handle, 0)) < 0) {
-                    ErrorMsg = "error: [" + std::to_string(result) + "] could not claim interface 0 of Push 2 device";
-                    libusb_close(device_handle);
-                    device_handle = NULL;
-                } else {
-                    break; // successfully opened
-                }
-            }
+    // MIDI is attached but the display did not open with it (still enumerating, or claimed elsewhere)
+    void retryDisplay() {
+        {
+            std::shared_lock<std::shared_mutex> lock(transportMutex);
+            if (transport->hasDisplay()) return;
         }
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastDisplayAttempt < std::chrono::milliseconds(DISPLAY_RETRY_MS)) return;
+        lastDisplayAttempt = now;
 
-        if (device_handle == NULL) {
-            std::cout << ErrorMsg << std::endl;
+        bool displayOpen;
+        {
+            std::unique_lock<std::shared_mutex> lock(transportMutex);
+            displayOpen = transport->openDisplay();
+        }
+        if (!displayOpen) return;
+        std::cout << transport->name() << " display attached" << std::endl;
+        if (reattachHandler) {
+            reattachHandler();
         }
-
-        libusb_free_device_list(devices, 1);
-        return device_handle;
     }
 
-    static void close_push2_device(libusb_device_handle* device_handle) {
-        libusb_release_interface(device_handle, 0);
-        libusb_close(device_handle);
+    void hotplugLoop() {
+        std::unique_lock<std::mutex> lock(hotplugMutex);
+        while (!hotplugStopped) {
+            // Right after a plug event the MIDI ports are a few hundred ms behind the USB device
+            bool arriving = arrivalPending &&
+                std::chrono::steady_clock::now() - arrivedAt < std::chrono::milliseconds(ARRIVAL_WINDOW_MS);
+            hotplugCondition.wait_for(lock, std::chrono::milliseconds(arriving ? ARRIVAL_RESCAN_MS : RESCAN_MS),
+                                      [this] { return hotplugStopped || rescanPending; });
+            if (hotplugStopped) break;
+            rescanPending = false;
+            lock.unlock();
+            checkDevice();
+            lock.lock();
+        }
     }
-    
+
 public:
-    PushUSB() : isConnected(false) {
-        try {
-            midiIn = std::make_unique<RtMidiIn>();
-            midiOut = std::make_unique<RtMidiOut>();
-        } catch (RtMidiError& error) {
-            std::cerr << "RtMidi initialization error: " << error.getMessage() << std::endl;
-        }
+    // Talks to the real Push 2 unless given another transport
+    explicit PushUSB(std::unique_ptr<PushTransport> deviceTransport = nullptr)
+        : transport(deviceTransport ? std::move(deviceTransport) : std::make_unique<PushHardwareTransport>()),
+          isConnected(false) {
+        midiDispatcher.setSysExHandler([this](const PushMidiMessage& msg) {
+            return sysexTransactions.handleReply(msg);
+        });
     }
     
     ~PushUSB() {
+        stopHotplug();
+        sysexTransactions.shutdown();
         disconnect();
     }
     
     bool initialize() {
-        return midiIn && midiOut;
+        return transport->initialize();
     }
+
+    PushTransport& getTransport() { return *transport; }
     
     bool connect() {
         if (isConnected.load()) {
             return true;
         }
-        
-        if (!midiIn || !midiOut) {
-            std::cerr << "MIDI objects not initialized" << std::endl;
-            return false;
-        }
-        
-        try {
-            unsigned int inputPort, outputPort;
-            if (!findPush2MidiPorts(inputPort, outputPort)) {
-                std::cerr << "Could not find Push 2 MIDI ports" << std::endl;
-                std::cout << "\nAvailable MIDI Input Ports:" << std::endl;
-                for (unsigned int i = 0; i < midiIn->getPortCount(); i++) {
-                    std::cout << "  " << i << ": " << midiIn->getPortName(i) << std::endl;
-                }
-                std::cout << "\nAvailable MIDI Output Ports:" << std::endl;
-                for (unsigned int i = 0; i < midiOut->getPortCount(); i++) {
-                    std::cout << "  " << i << ": " << midiOut->getPortName(i) << std::endl;
-                }
-                return false;
-            }
-            
-            // Open MIDI ports
-            midiIn->openPort(inputPort);
-            midiOut->openPort(outputPort);
-            
-            // Set up input callback - THIS IS IMPORTANT FOR RECEIVING INPUT
-            midiIn->setCallback(&midiInputCallback, this);
-            midiIn->ignoreTypes(false, false, false); // Don't ignore any message types
-            
-            isConnected.store(true);
-            std::cout << "Successfully connected to Push 2 MIDI ports" << std::endl;
-            
-            // Test the connection
-            clearAllPads();            
-        } catch (RtMidiError& error) {
-            std::cerr << "MIDI connection error: " << error.getMessage() << std::endl;
-            return false;
-        }
-
-        std::cout << "Opening Push 2 USB display..." << std::endl;
-        deviceHandle = open_push2_device();
 
-        if (!deviceHandle) {
-            std::cerr << "Failed to open Push 2 USB display" << std::endl;
+        bool displayOpen = false;
+        if (!attach(displayOpen)) {
             return false;
         }
+        std::cout << "Successfully connected to " << transport->name() << " MIDI ports" << std::endl;
 
-        return true;
+        // Test the connection
+        clearAllPads();
+
+        return displayOpen;
     }
     
     void disconnect() {
-        if (!isConnected.load()) {
+        if (!isConnected.exchange(false)) {
             return;
         }
-        
-        try {
-            if (midiIn && midiIn->isPortOpen()) {
-                midiIn->closePort();
-            }
-            if (midiOut && midiOut->isPortOpen()) {
-                midiOut->closePort();
-            }
-            
-            isConnected.store(false);
-            std::cout << "Disconnected from Push 2 MIDI" << std::endl;
-            
-        } catch (RtMidiError& error) {
-            std::cerr << "MIDI disconnect error: " << error.getMessage() << std::endl;
+        midiShaper.clear();
+        {
+            std::unique_lock<std::shared_mutex> lock(transportMutex);
+            transport->close();
+        }
+        std::cout << "Disconnected from " << transport->name() << std::endl;
+    }
+
+    // Keep the device attached from now on: after it is unplugged (or if it wasn't there to begin
+    // with) it is reattached in the background, and onReattach runs on that thread to restore what
+    // it showed. Everything else, including the tracked Resolume state, carries on meanwhile.
+    void startHotplug(std::function<void()> onReattach) {
+        if (hotplugThread.joinable()) {
+            return;
+        }
+        reattachHandler = std::move(onReattach);
+        plugEvents = transport->watchPlugEvents([this](bool arrived) {
+            notePlugEvent(arrived);
+        });
+        hotplugThread = std::thread(&PushUSB::hotplugLoop, this);
+    }
+
+    void stopHotplug() {
+        if (!hotplugThread.joinable()) {
+            return;
         }
+        transport->stopPlugEvents();
+        {
+            std::lock_guard<std::mutex> lock(hotplugMutex);
+            hotplugStopped = true;
+        }
+        hotplugCondition.notify_all();
+        hotplugThread.join();
+    }
 
-        if (deviceHandle) {
-            std::cout << "Closing Push 2 USB display..." << std::endl;
-            close_push2_device(deviceHandle);
-            deviceHandle = nullptr;
+    // The LED frame that restores a reattached device was just written (LED pipeline thread)
+    void noteRestored() {
+        std::lock_guard<std::mutex> lock(hotplugMutex);
+        if (!restoreTimed) return;
+        restoreTimed = false;
+        lastReattachMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - restoreArrivedAt).count();
+        worstReattachMs = std::max(worstReattachMs, lastReattachMs);
+        std::cout << transport->name() << " restored, usable " << lastReattachMs << " ms after it was plugged in" << std::endl;
+    }
+
+    void printHotplugStats() {
+        std::lock_guard<std::mutex> lock(hotplugMutex);
+        std::cout << "Hot-plug: " << (plugEvents ? "plug events and " : "") << "rescans every " << RESCAN_MS
+                  << " ms, " << removals << " removals, " << reattaches << " reattaches";
+        if (lastReattachMs >= 0.0) {
+            std::cout << ", usable after plug-in: last " << lastReattachMs << " ms, worst " << worstReattachMs << " ms";
         }
+        std::cout << std::endl;
     }
     
     bool isDeviceConnected() const { 
         return isConnected.load(); 
     }
     
-    // Set callback for receiving MIDI input from Push 2
+    // Set callback for receiving MIDI input from Push 2. It runs on the MIDI dispatcher thread.
     void setMidiCallback(std::function<void(const PushMidiMessage&)> callback) {
-        midiCallback = callback;
+        midiDispatcher.setCallback(std::move(callback));
+    }
+
+    void printMidiInputStats() const {
+        std::cout << "MIDI input: " << midiDispatcher.getMessagesReceived() << " messages, "
+                  << midiDispatcher.getMessagesDropped() << " dropped (queue full), "
+                  << midiDispatcher.getSysExDropped() << " SysEx dropped, queue depth "
+                  << midiDispatcher.getQueueDepth() << std::endl;
+        sysexTransactions.printStats();
     }
     
-    // Send raw MIDI message
-    bool sendMidiMessage(const std::vector<uint8_t>& message) {
-        if (!isConnected.load() || !midiOut || !midiOut->isPortOpen()) {
-            return false;
-        }
-        
-        try {
-            midiOut->sendMessage(&message);
-            return true;
-        } catch (RtMidiError& error) {
-            std::cerr << "MIDI send error: " << error.getMessage() << std::endl;
+    // Groups all MIDI output of its scope (e.g. one LED frame) into as few writes as the backend allows
+    class MidiBatch {
+        PushUSB& push;
+        bool unpaced = false;
+    public:
+        explicit MidiBatch(PushUSB& device) : push(device) { push.beginMidiBatch(); }
+        ~MidiBatch() { push.endMidiBatch(unpaced); }
+        // Send the whole batch in one burst on release, regardless of the output budget
+        void ignoreBudget() { unpaced = true; }
+        MidiBatch(const MidiBatch&) = delete;
+        MidiBatch& operator=(const MidiBatch&) = delete;
+    };
+
+    void beginMidiBatch() {
+        midiShaper.hold();
+    }
+
+    bool endMidiBatch(bool ignoreBudget = false) {
+        return midiShaper.release(ignoreBudget);
+    }
+
+    // Send one complete MIDI message (channel message or SysEx)
+    bool sendMidiBytes(const uint8_t* data, size_t size, MidiPriority priority = MidiPriority::Repaint) {
+        if (!isConnected.load()) {
             return false;
         }
+        midiOutMessages++;
+        return midiShaper.send(data, size, priority);
+    }
+
+    // Write now, after anything already queued (for requests that wait for a reply)
+    bool sendMidiBytesNow(const uint8_t* data, size_t size) {
+        midiOutMessages++;
+        return midiShaper.sendNow(data, size);
+    }
+
+    // Output budget in bytes per millisecond, 0 = unlimited
+    void setMidiBudget(double bytesPerMs) {
+        midiShaper.setBudget(bytesPerMs);
+    }
+
+    // Send raw MIDI message
+    bool sendMidiMessage(const std::vector<uint8_t>& message) {
+        return sendMidiBytes(message.data(), message.size());
     }
     
     // Send SysEx message
@@ -292,15 +376,49 @@ public:
         return sendMidiMessage(sysex);
     }
 
+    void printMidiOutputStats() {
+        std::cout << "MIDI output: " << midiOutMessages.load() << " messages, " << midiOutBytes.load() << " bytes in "
+                  << midiOutWrites.load() << " backend writes" << (midiOutAcceptsStreams ? "" : " (one message per write)")
+                  << std::endl;
+        midiShaper.printStats();
+    }
+
+    // Repaint the whole pad grid twice, once message-by-message and once batched, and report
+    // backend writes (one write syscall each on ALSA) and wall time for each
+    void benchmarkGridRepaint() {
+        using Clock = std::chrono::steady_clock;
+        auto repaint = [this](uint8_t colorIndex) {
+            for (int note = 36; note <= 99; note++) {
+                setPadColorIndex(note, colorIndex);
+            }
+        };
+        for (int batched = 0; batched <= 1; ++batched) {
+            uint64_t writesBefore = midiOutWrites.load();
+            auto start = Clock::now();
+            if (batched) {
+                MidiBatch batch(*this);
+                repaint(126);
+            } else {
+                repaint(125);
+            }
+            auto elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+            std::cout << "Grid repaint " << (batched ? "batched:   " : "unbatched: ") << (midiOutWrites.load() - writesBefore)
+                      << " writes, " << elapsedUs << " us" << std::endl;
+        }
+        clearAllPads();
+    }
+
     void reapplyPalette() {
-        std::vector<uint8_t> sysex = {
+        const uint8_t sysex[] = {
             0xF0, 0x00, 0x21, 0x1D, 0x01, 0x01, 0x05, 0xF7
         };
-        sendSysEx(sysex);
+        sendMidiBytes(sysex, sizeof(sysex), MidiPriority::Feedback);
     }
 
-    // Send Push 2 palette sysex command
-    void setPaletteEntry(uint8_t index, uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
+    // Send Push 2 palette sysex command. Pass reapply = false when setting several entries
+    // and call reapplyPalette() once afterwards. Palette entries go out ahead of repaints,
+    // since LEDs of either priority may refer to them.
+    void setPaletteEntry(uint8_t index, uint8_t r, uint8_t g, uint8_t b, uint8_t w, bool reapply = true) {
         // Split each color into LSB (7 bits) and MSB (1 bit)
         auto split = [](uint8_t v) -> std::pair<uint8_t, uint8_t> {
             return { static_cast<uint8_t>(v & 0x7F), static_cast<uint8_t>((v >> 7) & 0x01) };
@@ -310,7 +428,7 @@ public:
         auto [b_lsb, b_msb] = split(b);
         auto [w_lsb, w_msb] = split(w);
 
-        std::vector<uint8_t> sysex = {
+        const uint8_t sysex[] = {
             0xF0, 0x00, 0x21, 0x1D, 0x01, 0x01, 0x03, // header + command
             index,
             r_lsb, r_msb,
@@ -319,110 +437,148 @@ public:
             w_lsb, w_msb,
             0xF7
         };
-        sendSysEx(sysex);
-        reapplyPalette();
+        sendMidiBytes(sysex, sizeof(sysex), MidiPriority::Feedback);
+        if (reapply) {
+            reapplyPalette();
+        }
     }
     
-    bool setPadColorIndex(int padNumber, uint8_t colorIndex) {
+    // channel 0 shows the colour; other channels select a device-side animation (see LedAnimation)
+    bool setPadColorIndex(int padNumber, uint8_t colorIndex, uint8_t channel = 0,
+                          MidiPriority priority = MidiPriority::Repaint) {
         if (!isConnected.load() || padNumber < 36 || padNumber > 99) {
             return false;
         }
 
-        return sendMidiMessage({0x90, static_cast<uint8_t>(padNumber), colorIndex});
+        const uint8_t message[3] = {static_cast<uint8_t>(0x90 | (channel & 0x0F)), static_cast<uint8_t>(padNumber), colorIndex};
+        return sendMidiBytes(message, sizeof(message), priority);
     }
 
     // Set button color (control change)
-    bool setButtonColorIndex(int buttonNumber, uint8_t colorIndex) {
+    bool setButtonColorIndex(int buttonNumber, uint8_t colorIndex, uint8_t channel = 0,
+                             MidiPriority priority = MidiPriority::Repaint) {
         if (!isConnected.load()) {
             return false;
         }
 
-        return sendMidiMessage({0xB0, static_cast<uint8_t>(buttonNumber), colorIndex});
+        const uint8_t message[3] = {static_cast<uint8_t>(0xB0 | (channel & 0x0F)), static_cast<uint8_t>(buttonNumber), colorIndex};
+        return sendMidiBytes(message, sizeof(message), priority);
     }
     
     // Clear all pads
     bool clearAllPads() {
+        MidiBatch batch(*this);
         bool success = true;
         for (int note = 36; note <= 99; note++) {
-            success &= sendMidiMessage({0x90, static_cast<uint8_t>(note), 0x00});
+            const uint8_t message[3] = {0x90, static_cast<uint8_t>(note), 0x00};
+            success &= sendMidiBytes(message, sizeof(message));
         }
         return success;
     }
 
-    // Get palette entry from Push 2 (blocking, returns true if reply received)
-    bool getPaletteEntry(uint8_t index, uint8_t& r, uint8_t& g, uint8_t& b, uint8_t& w) {
-        // Send sysex request: F0 00 21 1D 01 01 04 00 <index> F7
-        std::vector<uint8_t> sysex = {
-            0xF0, 0x00, 0x21, 0x1D, 0x01, 0x01, 0x04, 0x00, index, 0xF7
-        };
+    // Ask the Push 2 for a palette entry; the reply runs on the MIDI dispatcher thread,
+    // with ok = false if the device didn't answer in time
+    using PaletteReply = std::function<void(bool ok, const PushPaletteColor& color)>;
+
+    void requestPaletteEntry(uint8_t index, PaletteReply reply,
+                             int timeoutMs = PushSysExTransactions::DEFAULT_TIMEOUT_MS) {
+        // Request: F0 00 21 1D 01 01 04 <index> F7
+        // Reply:   F0 00 21 1D 01 01 04 <index> r_lsb r_msb g_lsb g_msb b_lsb b_msb w_lsb w_msb F7
+        const uint8_t args[] = {index};
+        sysexTransactions.request(0x04, index, args, sizeof(args),
+            [reply = std::move(reply)](const uint8_t* data, size_t size) {
+                PushPaletteColor color;
+                if (!data || size < 17) {
+                    reply(false, color);
+                    return;
+                }
+                auto join = [data](int offset) {
+                    return static_cast<uint8_t>((data[offset] & 0x7F) | ((data[offset + 1] & 0x01) << 7));
+                };
+                color.r = join(8);
+                color.g = join(10);
+                color.b = join(12);
+                color.w = join(14);
+                reply(true, color);
+            }, timeoutMs);
+    }
 
-        // We'll need to capture the reply. This is a blocking call and not thread safe.
-        // In a real implementation, this should be async/event-driven.
-        std::atomic<bool> gotReply{false};
-        uint8_t replyR = 0, replyG = 0, replyB = 0, replyW = 0;
-
-        auto oldCallback = midiCallback;
-        midiCallback = [&](const PushMidiMessage& msg) {
-            // Expect: F0 00 21 1D 01 01 04 00 <index> r g b w F7
-            if (msg.data.size() >= 13 &&
-                msg.data[0] == 0xF0 && msg.data[1] == 0x00 && msg.data[2] == 0x21 &&
-                msg.data[3] == 0x1D && msg.data[4] == 0x01 && msg.data[5] == 0x01 &&
-                msg.data[6] == 0x04 && msg.data[7] == 0x00 && msg.data[8] == index &&
-                msg.data[12] == 0xF7) {
-                replyR = msg.data[9];
-                replyG = msg.data[10];
-                replyB = msg.data[11];
-                replyW = msg.data[12 - 1]; // msg.data[11] is b, msg.data[12] is w
-                gotReply = true;
-            }
+    // Read entries [first, last] with every request in flight at once; blocks for at most one
+    // timeout and returns how many answered. Must not be called from the MIDI callback.
+    int readPalette(uint8_t first, uint8_t last, PushPaletteColor* colors, bool* valid) {
+        struct Readback {
+            std::mutex mutex;
+            std::condition_variable done;
+            int remaining = 0;
+            int answered = 0;
         };
-
-        sendSysEx(sysex);
-
-        // Wait for reply (timeout after 100ms)
-        for (int i = 0; i < 100; ++i) {
-            if (gotReply) break;
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        auto readback = std::make_shared<Readback>();
+        readback->remaining = last - first + 1;
+
+        for (int index = first; index <= last; ++index) {
+            int slot = index - first;
+            valid[slot] = false;
+            requestPaletteEntry(static_cast<uint8_t>(index), [readback, colors, valid, slot](bool ok, const PushPaletteColor& color) {
+                std::lock_guard<std::mutex> lock(readback->mutex);
+                if (ok) {
+                    colors[slot] = color;
+                    valid[slot] = true;
+                    readback->answered++;
+                }
+                if (--readback->remaining == 0) readback->done.notify_all();
+            });
         }
 
-        midiCallback = oldCallback;
+        std::unique_lock<std::mutex> lock(readback->mutex);
+        readback->done.wait(lock, [&readback] { return readback->remaining == 0; });
+        return readback->answered;
+    }
 
-        if (gotReply) {
-            r = replyR;
-            g = replyG;
-            b = replyB;
-            w = replyW;
-            return true;
-        }
-        return false;
+    // Get one palette entry (blocking, returns true if reply received)
+    bool getPaletteEntry(uint8_t index, uint8_t& r, uint8_t& g, uint8_t& b, uint8_t& w) {
+        PushPaletteColor color;
+        bool valid = false;
+        readPalette(index, index, &color, &valid);
+        if (valid) {
+            r = color.r;
+            g = color.g;
+            b = color.b;
+            w = color.w;
+        }
+        return valid;
     }
 
-    // Set just the RGB part of a palette entry (preserve W)
+    // Set just the RGB part of a palette entry (preserve W). Returns immediately; the entry
+    // is written once the current value has been read back (or with W = 0 if that failed).
     void setPaletteEntryRGB(uint8_t index, uint8_t r, uint8_t g, uint8_t b) {
-        uint8_t oldR = 0, oldG = 0, oldB = 0, oldW = 0;
-        if (getPaletteEntry(index, oldR, oldG, oldB, oldW)) {
-            setPaletteEntry(index, r, g, b, oldW);
-        } else {
-            setPaletteEntry(index, r, g, b, 0);
-        }
+        requestPaletteEntry(index, [this, index, r, g, b](bool, const PushPaletteColor& old) {
+            setPaletteEntry(index, r, g, b, old.w);
+        });
     }
 
-    // Set just the BW part of a palette entry (preserve RGB)
+    // Set just the BW part of a palette entry (preserve RGB), likewise without blocking
     void setPaletteEntryBW(uint8_t index, uint8_t w) {
-        uint8_t oldR = 0, oldG = 0, oldB = 0, oldW = 0;
-        if (getPaletteEntry(index, oldR, oldG, oldB, oldW)) {
-            setPaletteEntry(index, oldR, oldG, oldB, w);
-        } else {
-            setPaletteEntry(index, 0, 0, 0, w);
-        }
+        requestPaletteEntry(index, [this, index, w](bool, const PushPaletteColor& old) {
+            setPaletteEntry(index, old.r, old.g, old.b, w);
+        });
     }
 
-    // Set touch strip LEDs (31 LEDs, values 0-7)
-    bool setTouchStripLEDs(const uint8_t ledValues[31]) {
-        if (!isConnected.load()) {
-            return false;
-        }
+    // Read back the whole palette and report how long it took
+    void benchmarkPaletteReadback() {
+        PushPaletteColor colors[128];
+        bool valid[128];
+        auto start = std::chrono::steady_clock::now();
+        int answered = readPalette(0, 127, colors, valid);
+        auto elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Palette readback: " << answered << "/128 entries in " << elapsedMs << " ms" << std::endl;
+        sysexTransactions.printStats();
+    }
+
+    // Touch strip LEDs SysEx: header, command 0x19, 16 packed bytes, F7
+    static constexpr size_t TOUCH_STRIP_SYSEX_SIZE = 24;
 
+    // Encode 31 LED values (0-7) into a ready-to-send touch strip SysEx; false if a value is out of range
+    static bool encodeTouchStripLEDs(const uint8_t ledValues[31], uint8_t sysex[TOUCH_STRIP_SYSEX_SIZE]) {
         // Validate LED values are in range 0-7
         for (int i = 0; i < 31; ++i) {
             if (ledValues[i] > 7) {
@@ -430,27 +586,37 @@ public:
             }
         }
 
-        // Pack LED values according to specification:
-        // Each byte packs two 3-bit LED values, with LED 30 getting special treatment
-        std::vector<uint8_t> sysex = {
-            0xF0, 0x00, 0x21, 0x1D, 0x01, 0x01, 0x19 // header + command ID
-        };
+        const uint8_t header[7] = {0xF0, 0x00, 0x21, 0x1D, 0x01, 0x01, 0x19}; // header + command ID
+        std::memcpy(sysex, header, sizeof(header));
 
         // Pack LEDs 0-29 into 15 bytes (2 LEDs per byte)
         for (int i = 0; i < 15; i++) {
             uint8_t led_low = ledValues[i * 2];     // even index LED
             uint8_t led_high = ledValues[i * 2 + 1]; // odd index LED
-            uint8_t packed = (led_high << 3) | led_low;
-            sysex.push_back(packed);
+            sysex[7 + i] = static_cast<uint8_t>((led_high << 3) | led_low);
         }
 
         // Pack LED 30 into the last byte (bits 2-0, with bits 7-3 as zero)
-        uint8_t last_byte = ledValues[30] & 0x07;
-        sysex.push_back(last_byte);
+        sysex[22] = ledValues[30] & 0x07;
+        sysex[23] = 0xF7; // end of sysex
+        return true;
+    }
 
-        sysex.push_back(0xF7); // end of sysex
+    // Send a touch strip SysEx built by encodeTouchStripLEDs; direct feedback for the performer's finger
+    bool sendTouchStripSysEx(const uint8_t sysex[TOUCH_STRIP_SYSEX_SIZE]) {
+        if (!isConnected.load()) {
+            return false;
+        }
+        return sendMidiBytes(sysex, TOUCH_STRIP_SYSEX_SIZE, MidiPriority::Feedback);
+    }
 
-        return sendSysEx(sysex);
+    // Set touch strip LEDs (31 LEDs, values 0-7)
+    bool setTouchStripLEDs(const uint8_t ledValues[31]) {
+        uint8_t sysex[TOUCH_STRIP_SYSEX_SIZE];
+        if (!isConnected.load() || !encodeTouchStripLEDs(ledValues, sysex)) {
+            return false;
+        }
+        return sendTouchStripSysEx(sysex);
     }
 
     // Configure touch strip for host control via sysex commands
@@ -482,22 +648,22 @@ public:
 
     // Send frame to Push 2 display
     bool sendDisplayFrameBlocking(const uint8_t* rgbaData) { // array is assumed to be 960x160 RGBA8
-        if (!deviceHandle || !rgbaData) {
+        std::shared_lock<std::shared_mutex> lock(transportMutex);
+        if (!transport->hasDisplay() || !rgbaData) {
             return false;
         }
 
         // Send frame header first
-        uint8_t frameHeader[16] = {
+        const uint8_t frameHeader[16] = {
             0xFF, 0xCC, 0xAA, 0x88,
             0x00, 0x00, 0x00, 0x00,
             0x00, 0x00, 0x00, 0x00,
             0x00, 0x00, 0x00, 0x00
         };
 
-        int transferred = 0;
-        int result = libusb_bulk_transfer(deviceHandle, 0x01, frameHeader, 16, &transferred, 1000);
-        if (result != 0 || transferred != 16) {
-            std::cerr << "Failed to send frame header: " << result << std::endl;
+        if (!transport->writeDisplay(frameHeader, 16, 1000)) {
+            std::cerr << "Failed to send frame header" << std::endl;
+            requestRescan();
             return false;
         }
 
@@ -509,9 +675,9 @@ public:
             convertLineToRGB565(rgbaData + (y * 960 * 4), lineBuffer, 960);
 
             // Send line buffer
-            result = libusb_bulk_transfer(deviceHandle, 0x01, lineBuffer, 2048, &transferred, 1000);
-            if (result != 0 || transferred != 2048) {
-                std::cerr << "Failed to send line " << y << ": " << result << std::endl;
+            if (!transport->writeDisplay(lineBuffer, 2048, 1000)) {
+                std::cerr << "Failed to send line " << y << std::endl;
+                requestRescan();
                 return false;
             }
         }
@@ -13,6 +13,9 @@
 #include <functional>
 #include <thread>
 #include <atomic>
+#include <shared_mutex>
+#include <mutex>
+#include <algorithm>
 #include "PropertyDictionary.h"
 
 // Include the ResolumeOSCListener header to provide the full type definition
@@ -409,6 +412,28 @@ private:
 
     // Add reference to OSC listener for queries
     ResolumeOSCListener* oscListener = nullptr;
+
+    // Guards all tracked state. The processing thread applies each batch under an exclusive lock,
+    // readers hold readLock() so a group of getter calls sees a single state version.
+    mutable std::shared_mutex stateMutex;
+    std::atomic<uint64_t> stateVersion{0};
+
+    // Called after every new state version, with stateMutex held exclusively
+    std::function<void()> changeObserver;
+
+    // Caller must hold stateMutex exclusively
+    void publishChange() {
+        stateVersion++;
+        if (changeObserver) changeObserver();
+    }
+
+    // Parts of the composition that may be stale after packet loss, each until the re-query with
+    // its sync id has been answered. Guarded by stateMutex.
+    struct SuspectRegion {
+        uint64_t syncId;
+        int firstLayer, lastLayer, firstColumn, lastColumn;
+    };
+    std::vector<SuspectRegion> suspectRegions;
     
     // Message processing thread
     std::thread processingThread;
@@ -417,9 +442,9 @@ private:
     void messageProcessingLoop() {
         while (!shouldStopProcessing.load()) {
             if (oscListener) {
-                auto message = oscListener->getNextMessage();
-                if (message.has_value()) {
-                    processOSCMessage(message->address, message->floats, message->integers, message->strings);
+                auto batch = oscListener->getNextBatch();
+                if (batch.has_value()) {
+                    applyBatch(*batch);
                 } else {
                     // Increase sleep time to reduce CPU usage and potential race conditions
                     std::this_thread::sleep_for(std::chrono::milliseconds(1)); // Changed from microseconds(10)
@@ -478,8 +503,70 @@ public:
         return maxClips;
     }
 
+    // Read access to the tracked state; hold this around getter calls that must agree with each other
+    std::shared_lock<std::shared_mutex> readLock() const {
+        return std::shared_lock<std::shared_mutex>(stateMutex);
+    }
+
+    // Incremented once per applied message or bundle
+    uint64_t getStateVersion() const { return stateVersion.load(); }
+
+    // Be told about every state change (e.g. to schedule a redraw); must be cheap and must not
+    // touch the tracker. nullptr to detach.
+    void setChangeObserver(std::function<void()> observer) {
+        std::unique_lock<std::shared_mutex> lock(stateMutex);
+        changeObserver = std::move(observer);
+    }
+
+    // Layers and columns are 1-based and inclusive. Marking and clearing is a state change, so the
+    // Push redraws the affected pads.
+    void markSuspect(uint64_t syncId, int firstLayer, int lastLayer, int firstColumn, int lastColumn) {
+        std::unique_lock<std::shared_mutex> lock(stateMutex);
+        suspectRegions.push_back({syncId, firstLayer, lastLayer, firstColumn, lastColumn});
+        publishChange();
+    }
+
+    void clearSuspect(const std::vector<uint64_t>& syncIds) {
+        std::unique_lock<std::shared_mutex> lock(stateMutex);
+        size_t before = suspectRegions.size();
+        suspectRegions.erase(std::remove_if(suspectRegions.begin(), suspectRegions.end(),
+            [&syncIds](const SuspectRegion& region) {
+                return std::find(syncIds.begin(), syncIds.end(), region.syncId) != syncIds.end();
+            }), suspectRegions.end());
+        if (suspectRegions.size() != before) publishChange();
+    }
+
+    // Caller must hold readLock()
+    bool isClipSuspect(int column, int layer) const {
+        for (const auto& region : suspectRegions) {
+            if (layer >= region.firstLayer && layer <= region.lastLayer &&
+                column >= region.firstColumn && column <= region.lastColumn) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Apply all messages of a bundle as one transaction, published as a single state version
+    void applyBatch(const OSCListenerBatch& batch) {
+        std::unique_lock<std::shared_mutex> lock(stateMutex);
+        for (const auto& message : batch) {
+            applyOSCMessage(message.address, message.floats, message.integers, message.strings);
+        }
+        publishChange();
+    }
+
     void processOSCMessage(const std::string& address, const std::vector<float>& floats,
                            const std::vector<int>& integers, const std::vector<std::string>& strings) {
+        std::unique_lock<std::shared_mutex> lock(stateMutex);
+        applyOSCMessage(address, floats, integers, strings);
+        publishChange();
+    }
+
+private:
+    // Caller must hold stateMutex exclusively
+    void applyOSCMessage(const std::string& address, const std::vector<float>& floats,
+                         const std::vector<int>& integers, const std::vector<std::string>& strings) {
         try {
             // Only process /composition messages
             if (address.find("/composition") != 0) return;
@@ -507,7 +594,7 @@ public:
                 if (pathParts[2] == "select" && integers.empty()) { // && integers[0] == 1 apparently select is sent with no payload
                     if (deckId != currentDeckId) {
                         //std::cout << "Deck changed to: " << deckId << std::endl;
-                        clear();
+                        clearLocked();
                         currentDeckId = deckId;
                     }
                 }
@@ -589,7 +676,33 @@ public:
             std::cerr << "Unknown error processing OSC message: " << address << std::endl;
         }
     }
-    
+
+    // Caller must hold stateMutex exclusively
+    void clearLocked() {
+        selectedColumnId = 0;
+        connectedColumnId = 0;
+        selectedLayerId = 0;
+        selectedClipLayerId = 0;
+        selectedClipId = 0;
+        lastSelectionType = LastSelectionType::NONE;
+        //deckProperties.clear();
+
+        //clear the queue of messages
+        if (oscListener) {
+            oscListener->clearMessageQueue();
+        }
+
+        std::cout << "Queue cleared" << std::endl;
+        
+        layers.clear();
+        
+        //for (auto& layer : layers) {
+        //    layer->clear();
+        //}
+        // Removed: prevLayerCount and prevColumnCount reset
+    }
+
+public:
     std::shared_ptr<Layer> getOrCreateLayer(int layerId) {
         if (layerId < 1) return nullptr;
         
@@ -698,36 +811,30 @@ public:
     
     // Method to manually set/change deck (useful for testing)
     void setCurrentDeck(int deckId) {
+        std::unique_lock<std::shared_mutex> lock(stateMutex);
         if (deckInitialized && deckId != currentDeckId) {
             std::cout << "Manually changing deck from " << currentDeckId << " to " << deckId << " - clearing all data" << std::endl;
-            clear();
+            clearLocked();
         }
         currentDeckId = deckId;
         deckInitialized = true;
+        publishChange();
     }
     
     void clear() {
-        selectedColumnId = 0;
-        connectedColumnId = 0;
-        selectedLayerId = 0;
-        selectedClipLayerId = 0;
-        selectedClipId = 0;
-        lastSelectionType = LastSelectionType::NONE;
-        //deckProperties.clear();
+        std::unique_lock<std::shared_mutex> lock(stateMutex);
+        clearLocked();
+        publishChange();
+    }
 
-        //clear the queue of messages
-        if (oscListener) {
-            oscListener->clearMessageQueue();
+    // Timeout all clips in a layer except the given one (used right after triggering a clip)
+    void timeoutClipsExcept(int layerId, int exceptClipId) {
+        std::unique_lock<std::shared_mutex> lock(stateMutex);
+        auto layer = getLayer(layerId);
+        if (layer) {
+            layer->timeoutAllExcept(exceptClipId);
+            publishChange();
         }
-
-        std::cout << "Queue cleared" << std::endl;
-        
-        layers.clear();
-        
-        //for (auto& layer : layers) {
-        //    layer->clear();
-        //}
-        // Removed: prevLayerCount and prevColumnCount reset
     }
     
     // Additional convenience methods for PushUI integration
@@ -770,8 +877,10 @@ public:
 
     // Print method for trickle-down printing
     void print(const std::string& indent = "") const {
+        auto lock = readLock();
         std::cout << indent << "ResolumeTracker:" << std::endl;
-        std::cout << indent << "  Current Deck: " << currentDeckId << " (Initialized: " << (deckInitialized ? "Yes" : "No") << ")" << std::endl;
+        std::cout << indent << "  Current Deck: " << currentDeckId << " (Initialized: " << (deckInitialized ? "Yes" : "No") << ")"
+                  << (!suspectRegions.empty() ? " [suspect: resyncing after packet loss]" : "") << std::endl;
         std::cout << indent << "  Selected Column: " << selectedColumnId << ", Connected Column: " << connectedColumnId << std::endl;
         std::cout << indent << "  Selected Layer: " << selectedLayerId << ", Selected Clip: " << selectedClipId << " (Layer " << selectedClipLayerId << ")" << std::endl;
         
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// SLIP framing (RFC 1055) as used by OSC 1.1 over stream transports.
+// Packets are written as END <escaped bytes> END; the leading END flushes any line noise.
+namespace Slip {
+    constexpr uint8_t END = 0xC0;
+    constexpr uint8_t ESC = 0xDB;
+    constexpr uint8_t ESC_END = 0xDC;
+    constexpr uint8_t ESC_ESC = 0xDD;
+
+    // Worst case: every byte escaped, plus both delimiters
+    constexpr size_t maxEncodedSize(size_t size) { return size * 2 + 2; }
+
+    // out must hold maxEncodedSize(size) bytes; returns the encoded length
+    inline size_t encode(const char* data, size_t size, char* out) {
+        size_t length = 0;
+        out[length++] = static_cast<char>(END);
+        for (size_t i = 0; i < size; ++i) {
+            uint8_t byte = static_cast<uint8_t>(data[i]);
+            if (byte == END) {
+                out[length++] = static_cast<char>(ESC);
+                out[length++] = static_cast<char>(ESC_END);
+            } else if (byte == ESC) {
+                out[length++] = static_cast<char>(ESC);
+                out[length++] = static_cast<char>(ESC_ESC);
+            } else {
+                out[length++] = static_cast<char>(byte);
+            }
+        }
+        out[length++] = static_cast<char>(END);
+        return length;
+    }
+}
+
+// Streaming SLIP decoder: feed it whatever recv() returned, complete packets come out of the
+// callback. Frames larger than the buffer are discarded up to the next END.
+class SlipDecoder {
+public:
+    static constexpr size_t DEFAULT_MAX_PACKET = 65536;
+
+private:
+    std::unique_ptr<char[]> buffer;
+    size_t capacity;
+    size_t length = 0;
+    bool escaping = false;
+    bool overflowed = false;
+
+    // Statistics
+    uint64_t packetsDecoded = 0;
+    uint64_t oversizedPackets = 0;
+    uint64_t framingErrors = 0;
+
+    void append(char byte) {
+        if (length < capacity) {
+            buffer[length++] = byte;
+        } else {
+            overflowed = true;
+        }
+    }
+
+public:
+    explicit SlipDecoder(size_t maxPacketSize = DEFAULT_MAX_PACKET)
+        : buffer(new char[maxPacketSize]), capacity(maxPacketSize) {}
+
+    // callback(const char* data, size_t size) is called for every complete packet.
+    // The data is only valid during the call.
+    template <typename Callback>
+    void feed(const char* data, size_t size, Callback&& callback) {
+        for (size_t i = 0; i < size; ++i) {
+            uint8_t byte = static_cast<uint8_t>(data[i]);
+            if (escaping) {
+                escaping = false;
+                if (byte == Slip::ESC_END) {
+                    append(static_cast<char>(Slip::END));
+                } else if (byte == Slip::ESC_ESC) {
+                    append(static_cast<char>(Slip::ESC));
+                } else {
+                    // Protocol violation; keep the byte as RFC 1055 suggests
+                    framingErrors++;
+                    append(static_cast<char>(byte));
+                }
+                continue;
+            }
+
+            if (byte == Slip::END) {
+                if (overflowed) {
+                    oversizedPackets++;
+                } else if (length > 0) { // back-to-back ENDs delimit nothing
+                    packetsDecoded++;
+                    callback(static_cast<const char*>(buffer.get()), length);
+                }
+                length = 0;
+                overflowed = false;
+            } else if (byte == Slip::ESC) {
+                escaping = true;
+            } else {
+                append(static_cast<char>(byte));
+            }
+        }
+    }
+
+    // Drop a partial frame, e.g. after the connection was re-established
+    void reset() {
+        length = 0;
+        escaping = false;
+        overflowed = false;
+    }
+
+    uint64_t getPacketsDecoded() const { return packetsDecoded; }
+    uint64_t getOversizedPackets() const { return oversizedPackets; }
+    uint64_t getFramingErrors() const { return framingErrors; }
+};
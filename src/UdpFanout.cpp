@@ -0,0 +1,185 @@
+#include "UdpFanout.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>   // this must come first to prevent errors with MSVC7
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#include "ip/NetworkingUtils.h"
+
+#if defined(_WIN32)
+typedef SOCKET NativeSocket;
+static const NativeSocket INVALID_NATIVE_SOCKET = INVALID_SOCKET;
+static int lastSocketError() { return WSAGetLastError(); }
+static void closeNativeSocket(NativeSocket s) { closesocket(s); }
+#else
+typedef int NativeSocket;
+static const NativeSocket INVALID_NATIVE_SOCKET = -1;
+static int lastSocketError() { return errno; }
+static void closeNativeSocket(NativeSocket s) { close(s); }
+#endif
+
+static void sockaddrFromEndpoint(struct sockaddr_in& sockAddr, const IpEndpointName& endpoint) {
+    std::memset(&sockAddr, 0, sizeof(sockAddr));
+    sockAddr.sin_family = AF_INET;
+    sockAddr.sin_addr.s_addr = htonl(endpoint.address);
+    sockAddr.sin_port = htons(static_cast<unsigned short>(endpoint.port));
+}
+
+class UdpFanoutSocket::Implementation {
+public:
+    struct Destination {
+        std::string name;
+        struct sockaddr_in address;
+        std::atomic<uint64_t> packetsSent{0};
+        std::atomic<uint64_t> errors{0};
+        std::atomic<uint64_t> consecutiveErrors{0};
+        std::atomic<int> lastError{0};
+    };
+
+    NetworkInitializer networkInitializer_;
+    NativeSocket socket_;
+    Destination destinations_[MAX_DESTINATIONS];
+    std::atomic<size_t> destinationCount_{0};
+
+#if defined(__linux__)
+    // One message header per destination, all pointing at the same payload iovec
+    struct iovec payload_;
+    struct mmsghdr messages_[MAX_DESTINATIONS];
+#endif
+
+    Implementation() : socket_(INVALID_NATIVE_SOCKET) {
+        if ((socket_ = socket(AF_INET, SOCK_DGRAM, 0)) == INVALID_NATIVE_SOCKET) {
+            throw std::runtime_error("unable to create udp fanout socket\n");
+        }
+#if defined(__linux__)
+        std::memset(&payload_, 0, sizeof(payload_));
+        std::memset(messages_, 0, sizeof(messages_));
+#endif
+    }
+
+    ~Implementation() {
+        if (socket_ != INVALID_NATIVE_SOCKET) closeNativeSocket(socket_);
+    }
+
+    int addDestination(const IpEndpointName& endpoint, const std::string& name) {
+        size_t index = destinationCount_.load();
+        if (index >= MAX_DESTINATIONS) return -1;
+
+        Destination& destination = destinations_[index];
+        destination.name = name;
+        sockaddrFromEndpoint(destination.address, endpoint);
+#if defined(__linux__)
+        messages_[index].msg_hdr.msg_name = &destination.address;
+        messages_[index].msg_hdr.msg_namelen = sizeof(destination.address);
+        messages_[index].msg_hdr.msg_iov = &payload_;
+        messages_[index].msg_hdr.msg_iovlen = 1;
+#endif
+        destinationCount_.store(index + 1); // publish after the slot is complete
+        return static_cast<int>(index);
+    }
+
+    void recordSuccess(Destination& destination) {
+        destination.packetsSent++;
+        destination.consecutiveErrors.store(0);
+    }
+
+    void recordError(Destination& destination, int error) {
+        destination.errors++;
+        destination.consecutiveErrors++;
+        destination.lastError.store(error);
+    }
+
+    bool sendTo(size_t index, const char* data, size_t size) {
+        Destination& destination = destinations_[index];
+        int result = sendto(socket_, data, static_cast<int>(size), 0,
+                            reinterpret_cast<const struct sockaddr*>(&destination.address), sizeof(destination.address));
+        if (result < 0) {
+            recordError(destination, lastSocketError());
+            return false;
+        }
+        recordSuccess(destination);
+        return true;
+    }
+
+    size_t sendToAll(const char* data, size_t size) {
+        size_t count = destinationCount_.load();
+        size_t delivered = 0;
+#if defined(__linux__)
+        payload_.iov_base = const_cast<char*>(data);
+        payload_.iov_len = size;
+
+        size_t offset = 0;
+        while (offset < count) {
+            int sent = sendmmsg(socket_, messages_ + offset, static_cast<unsigned int>(count - offset), 0);
+            if (sent < 0) {
+                // The message at offset failed; skip it and carry on with the rest
+                recordError(destinations_[offset], errno);
+                offset++;
+                continue;
+            }
+            for (int i = 0; i < sent; ++i) {
+                recordSuccess(destinations_[offset + i]);
+            }
+            delivered += sent;
+            offset += sent;
+        }
+#else
+        for (size_t i = 0; i < count; ++i) {
+            if (sendTo(i, data, size)) delivered++;
+        }
+#endif
+        return delivered;
+    }
+};
+
+UdpFanoutSocket::UdpFanoutSocket() {
+    impl_ = new Implementation();
+}
+
+UdpFanoutSocket::~UdpFanoutSocket() {
+    delete impl_;
+}
+
+int UdpFanoutSocket::addDestination(const IpEndpointName& endpoint, const std::string& name) {
+    return impl_->addDestination(endpoint, name);
+}
+
+size_t UdpFanoutSocket::destinationCount() const {
+    return impl_->destinationCount_.load();
+}
+
+size_t UdpFanoutSocket::sendToAll(const char* data, size_t size) {
+    return impl_->sendToAll(data, size);
+}
+
+bool UdpFanoutSocket::sendTo(size_t destination, const char* data, size_t size) {
+    if (destination >= impl_->destinationCount_.load()) return false;
+    return impl_->sendTo(destination, data, size);
+}
+
+std::vector<UdpDestinationStats> UdpFanoutSocket::getStats() const {
+    std::vector<UdpDestinationStats> stats;
+    size_t count = impl_->destinationCount_.load();
+    for (size_t i = 0; i < count; ++i) {
+        const auto& destination = impl_->destinations_[i];
+        UdpDestinationStats entry;
+        entry.name = destination.name;
+        entry.packetsSent = destination.packetsSent.load();
+        entry.errors = destination.errors.load();
+        entry.consecutiveErrors = destination.consecutiveErrors.load();
+        entry.lastError = destination.lastError.load();
+        stats.push_back(entry);
+    }
+    return stats;
+}
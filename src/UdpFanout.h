@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "ip/IpEndpointName.h"
+
+// Per-destination delivery counters
+struct UdpDestinationStats {
+    std::string name;
+    uint64_t packetsSent = 0;
+    uint64_t errors = 0;
+    uint64_t consecutiveErrors = 0;
+    int lastError = 0;
+
+    bool healthy() const { return consecutiveErrors == 0; }
+};
+
+// Unconnected UDP socket that sends each datagram to a list of destinations.
+// The payload is shared by every copy; on Linux all copies go out with a single sendmmsg call.
+// Platform code lives in UdpFanout.cpp so socket headers don't leak into the rest of the tree.
+class UdpFanoutSocket {
+    class Implementation;
+    Implementation* impl_;
+
+public:
+    static constexpr size_t MAX_DESTINATIONS = 16;
+
+    // Throws std::runtime_error if the socket cannot be created
+    UdpFanoutSocket();
+    ~UdpFanoutSocket();
+
+    UdpFanoutSocket(const UdpFanoutSocket&) = delete;
+    UdpFanoutSocket& operator=(const UdpFanoutSocket&) = delete;
+
+    // May be called while another thread is sending (one adder at a time).
+    // Returns the destination index, or -1 if the list is full.
+    int addDestination(const IpEndpointName& endpoint, const std::string& name);
+    size_t destinationCount() const;
+
+    // Send the datagram to every destination; returns how many copies were accepted by the OS
+    size_t sendToAll(const char* data, size_t size);
+
+    // Send to a single destination (e.g. a relay target with its own filter)
+    bool sendTo(size_t destination, const char* data, size_t size);
+
+    std::vector<UdpDestinationStats> getStats() const;
+};
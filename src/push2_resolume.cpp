@@ -6,14 +6,23 @@
 #include <atomic>
 #include <memory>
 #include <string>
+#include <vector>
+#include <fstream>
 
 // Push 2 USB (adjust include paths to your install)
 #include "OSCSender.h"
 #include "PushUI.h"
 #include "PushUSB.h"
+#include "FakePushTransport.h"
+#include "LatencyBench.h"
 //#include "ResolumeTrackerREST.h"
 #include "ResolumeTrackerOSC.h"
 #include "OSCListener.h"
+#include "OSCRelay.h"
+#include "OSCTcpStream.h"
+#include "OSCSyncEngine.h"
+#include "OSCLossMonitor.h"
+#include "PushRefreshScheduler.h"
 
 // ------------------------
 // main()
@@ -23,6 +32,22 @@ int main(int argc, char* argv[]) {
     int incomingOscPort = 7000;
     std::string resolumeIp = "127.0.0.1";
     int resolumeOscPort = 6669;
+    int oscBundleWindowUs = -1; // -1 = bundling off
+    double continuousRateHz = 60.0;
+    std::vector<std::pair<std::string, int>> oscMirrors;
+    OSCRelay oscRelay;
+    std::string tcpConnect;     // <host>:<port>, empty = off
+    int tcpListenPort = -1;     // -1 = off
+    double syncRateQps = 500.0;
+    int paletteLevels = 0;      // 0 = exact LED colours
+    double ledRateHz = 120.0;
+    double displayRateHz = 30.0;
+    double midiBudget = PushMidiShaper::DEFAULT_BYTES_PER_MS;
+    bool fakePush = false;
+    std::string fakeScript;
+    int fakeUsbLatencyUs = FakePushTransport::DEFAULT_USB_LATENCY_US;
+    int benchSamples = 0;       // 0 = normal operation
+    LatencyBench::Options benchOptions;
 
     // Simple command line parsing
     for (int i = 1; i < argc; ++i) {
@@ -33,11 +58,103 @@ int main(int argc, char* argv[]) {
             resolumeOscPort = std::stoi(argv[++i]);
         } else if ((arg == "--ip" || arg == "-a") && i + 1 < argc) {
             resolumeIp = argv[++i];
+        } else if (arg == "--osc-bundle" && i + 1 < argc) {
+            oscBundleWindowUs = std::stoi(argv[++i]);
+        } else if (arg == "--cc-rate" && i + 1 < argc) {
+            continuousRateHz = std::stod(argv[++i]);
+        } else if (arg == "--mirror" && i + 1 < argc) {
+            std::string target = argv[++i];
+            size_t colon = target.rfind(':');
+            if (colon == std::string::npos) {
+                std::cerr << "--mirror expects <ip>:<port>" << std::endl;
+                return 1;
+            }
+            oscMirrors.emplace_back(target.substr(0, colon), std::stoi(target.substr(colon + 1)));
+        } else if (arg == "--relay" && i + 1 < argc) {
+            // <ip>:<port>[/subtree][@maxPacketsPerSecond]
+            std::string target = argv[++i];
+            OSCRelay::Target config{"", 0.0};
+            size_t at = target.find('@');
+            if (at != std::string::npos) {
+                config.maxPacketsPerSecond = std::stod(target.substr(at + 1));
+                target = target.substr(0, at);
+            }
+            size_t slash = target.find('/');
+            if (slash != std::string::npos) {
+                config.subtree = target.substr(slash);
+                target = target.substr(0, slash);
+            }
+            size_t colon = target.rfind(':');
+            if (colon == std::string::npos) {
+                std::cerr << "--relay expects <ip>:<port>[/subtree][@rate]" << std::endl;
+                return 1;
+            }
+            oscRelay.addTarget(target.substr(0, colon), std::stoi(target.substr(colon + 1)), config);
+        } else if (arg == "--osc-tcp" && i + 1 < argc) {
+            tcpConnect = argv[++i];
+            if (tcpConnect.rfind(':') == std::string::npos) {
+                std::cerr << "--osc-tcp expects <ip>:<port>" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--osc-tcp-listen" && i + 1 < argc) {
+            tcpListenPort = std::stoi(argv[++i]);
+        } else if (arg == "--osc-tcp-selftest" && i + 1 < argc) {
+            return OSCTcpStream::selfTest(std::stoi(argv[++i])) ? 0 : 1;
+        } else if (arg == "--sync-rate" && i + 1 < argc) {
+            syncRateQps = std::stod(argv[++i]);
+        } else if (arg == "--palette-levels" && i + 1 < argc) {
+            paletteLevels = std::stoi(argv[++i]);
+        } else if (arg == "--led-rate" && i + 1 < argc) {
+            ledRateHz = std::stod(argv[++i]);
+        } else if (arg == "--display-rate" && i + 1 < argc) {
+            displayRateHz = std::stod(argv[++i]);
+        } else if (arg == "--midi-budget" && i + 1 < argc) {
+            midiBudget = std::stod(argv[++i]);
+        } else if (arg == "--fake-push") {
+            fakePush = true;
+        } else if (arg == "--fake-script" && i + 1 < argc) {
+            fakeScript = argv[++i];
+            fakePush = true;
+        } else if (arg == "--fake-usb-latency" && i + 1 < argc) {
+            fakeUsbLatencyUs = std::stoi(argv[++i]);
+        } else if (arg == "--latency-bench" && i + 1 < argc) {
+            benchSamples = std::stoi(argv[++i]);
+            fakePush = true;
+        } else if (arg == "--latency-gate" && i + 1 < argc) {
+            // <pad -> OSC ms>:<OSC -> LED ms>
+            std::string gate = argv[++i];
+            size_t colon = gate.find(':');
+            if (colon == std::string::npos) {
+                std::cerr << "Invalid --latency-gate '" << gate << "', expected <ms>:<ms>" << std::endl;
+                return 1;
+            }
+            benchOptions.padToOscGateMs = std::stod(gate.substr(0, colon));
+            benchOptions.oscToLedGateMs = std::stod(gate.substr(colon + 1));
         } else if (arg == "--help" || arg == "-h") {
-            std::cout << "Usage: " << argv[0] << " [--in-port <port>] [--out-port <port>] [--ip <address>]" << std::endl;
+            std::cout << "Usage: " << argv[0] << " [--in-port <port>] [--out-port <port>] [--ip <address>] [--osc-bundle <us>] [--cc-rate <hz>] [--mirror <ip:port>]... [--relay <ip:port>[/subtree][@rate]]... [--osc-tcp <ip:port> | --osc-tcp-listen <port>] [--osc-tcp-selftest <port>] [--sync-rate <qps>] [--palette-levels <n>] [--led-rate <hz>] [--display-rate <hz>] [--midi-budget <bytes/ms>] [--fake-push [--fake-script <file>] [--fake-usb-latency <us>]] [--latency-bench <samples> [--latency-gate <ms>:<ms>]]" << std::endl;
             std::cout << "  --in-port,  -i   Incoming OSC port to listen on (default: 7000)" << std::endl;
             std::cout << "  --out-port, -o   Outgoing OSC port to Resolume (default: 6669)" << std::endl;
             std::cout << "  --ip,       -a   Resolume IP address (default: 127.0.0.1)" << std::endl;
+            std::cout << "  --osc-bundle     Bundle outgoing OSC within a window of <us> microseconds (0 = per UI frame)" << std::endl;
+            std::cout << "  --cc-rate        Max send rate per touch strip/encoder parameter in Hz (default: 60)" << std::endl;
+            std::cout << "  --mirror         Also send every outgoing OSC message to <ip:port> (repeatable)" << std::endl;
+            std::cout << "  --relay          Forward incoming OSC from Resolume to <ip:port>, optionally only an address" << std::endl;
+            std::cout << "                   subtree and at most <rate> packets per second (repeatable)" << std::endl;
+            std::cout << "  --osc-tcp        Talk to Resolume over OSC 1.1 TCP (SLIP framing) by connecting to <ip:port>" << std::endl;
+            std::cout << "  --osc-tcp-listen Talk to Resolume over OSC 1.1 TCP by accepting a connection on <port>" << std::endl;
+            std::cout << "  --osc-tcp-selftest  Round-trip SLIP framed packets over a loopback TCP pair on <port>, then exit" << std::endl;
+            std::cout << "  --sync-rate      Max state sync queries per second sent to Resolume (default: 500)" << std::endl;
+            std::cout << "  --palette-levels Quantize LED colours to <n> perceptual levels per channel (default: exact)" << std::endl;
+            std::cout << "  --led-rate       Max LED refresh rate in Hz; LEDs only redraw when something changed (default: 120)" << std::endl;
+            std::cout << "  --display-rate   Max display refresh rate in Hz (default: 30)" << std::endl;
+            std::cout << "  --midi-budget    MIDI output budget to the Push in bytes per ms; pressed pads and the touch" << std::endl;
+            std::cout << "                   strip go ahead of repaints beyond it (default: 32, 0 = unlimited)" << std::endl;
+            std::cout << "  --fake-push      Run against a simulated Push 2 that records all MIDI and display output" << std::endl;
+            std::cout << "  --fake-script    Feed the simulated Push 2 pad/button/touch strip input from <file>" << std::endl;
+            std::cout << "  --fake-usb-latency  Time each simulated USB transfer takes in microseconds (default: 125)" << std::endl;
+            std::cout << "  --latency-bench  Measure pad -> OSC and OSC -> LED latency over <samples> each against the" << std::endl;
+            std::cout << "                   simulated Push 2 and a fake Resolume on the out port, then exit" << std::endl;
+            std::cout << "  --latency-gate   Fail the bench (exit code 1) if a p99 is over <pad->OSC ms>:<OSC->LED ms> (default: 5:25)" << std::endl;
             std::cout << "  --help,     -h   Show this help message" << std::endl;
             return 0;
         }
@@ -53,55 +170,133 @@ int main(int argc, char* argv[]) {
     }
     //liveTreeMode = true;
 
+    int exitCode = 0;
     try {
-        // 1. Create OSC sender first (shared resource)
-        auto oscSender = std::make_shared<OSCSender>(resolumeIp, resolumeOscPort);
+        // Latency bench: stand in for Resolume on the out port before anything is sent to it
+        std::unique_ptr<LatencyBench> latencyBench;
+        if (benchSamples > 0) {
+            if (!tcpConnect.empty() || tcpListenPort >= 0) {
+                std::cerr << "The latency bench runs over UDP, not with --osc-tcp" << std::endl;
+                return 1;
+            }
+            resolumeIp = "127.0.0.1";
+            benchOptions.samples = benchSamples;
+            latencyBench = std::make_unique<LatencyBench>(resolumeOscPort, incomingOscPort);
+        }
+
+        // 1. Create OSC sender first (shared resource). With a TCP stream, Resolume is reached over TCP instead of UDP.
+        bool useTcp = !tcpConnect.empty() || tcpListenPort >= 0;
+        auto oscSender = useTcp ? std::make_shared<OSCSender>() : std::make_shared<OSCSender>(resolumeIp, resolumeOscPort);
+        for (const auto& mirror : oscMirrors) {
+            oscSender->addDestination(mirror.first, mirror.second);
+        }
+        if (oscBundleWindowUs >= 0) {
+            oscSender->enableBundling(std::chrono::microseconds(oscBundleWindowUs));
+        }
         
         // 2. Create OSC listener with the sender
         ResolumeOSCListener listener(oscSender.get());
+        if (!oscRelay.empty()) {
+            listener.setRelay(&oscRelay);
+        }
+
+        // State sync: query Resolume for what the Push shows, and watch the replies come back
+        OSCSyncEngine syncEngine(listener, syncRateQps);
+        listener.setMessageObserver([&syncEngine](const OSCListenerMessage& message) {
+            syncEngine.noteMessage(message.address);
+        });
+
+        // 2b. Optional OSC-over-TCP stream feeding the same listener
+        std::unique_ptr<OSCTcpStream> tcpStream;
+        if (useTcp) {
+            tcpStream = std::make_unique<OSCTcpStream>(&listener);
+            if (!tcpConnect.empty()) {
+                size_t colon = tcpConnect.rfind(':');
+                tcpStream->connect(tcpConnect.substr(0, colon), std::stoi(tcpConnect.substr(colon + 1)));
+            } else {
+                tcpStream->listen(tcpListenPort);
+            }
+            oscSender->setStream(tcpStream.get());
+        }
         
         // 3. Create Resolume tracker with the listener
         ResolumeTracker resolumeTracker(&listener);
 
-        // 4. Initialize Push 2 connection
-        PushUSB push;
+        // 4. Initialize Push 2 connection, or a simulated one
+        FakePushTransport* fakeDevice = nullptr;
+        std::unique_ptr<PushTransport> pushTransport;
+        if (fakePush) {
+            auto fake = std::make_unique<FakePushTransport>();
+            fake->setUsbLatency(fakeUsbLatencyUs);
+            fakeDevice = fake.get();
+            pushTransport = std::move(fake);
+            std::cout << "Using a simulated Push 2" << std::endl;
+        }
+        PushUSB push(std::move(pushTransport));
         if (!push.initialize()) {
             std::cerr << "Failed to initialize Push 2 MIDI" << std::endl;
             return 1;
         }
+        push.setMidiBudget(midiBudget);
         
         bool pushConnected = push.connect();
         if (pushConnected) {
             std::cout << "Push 2 connected successfully!" << std::endl;
         } else {
-            std::cout << "Push 2 not connected - continuing without Push 2" << std::endl;
+            std::cout << "Push 2 not connected - it will be picked up when plugged in" << std::endl;
         }
 
-        // 5. Create PushUI (only if Push is connected)
-        std::unique_ptr<PushUI> pushUI;
-        if (pushConnected) {
-            pushUI = std::make_unique<PushUI>(push, resolumeTracker, oscSender);
+        // 5. Create PushUI; without a Push it keeps tracking and shows up once one is attached
+        auto pushUI = std::make_unique<PushUI>(push, resolumeTracker, oscSender);
+        pushUI->setContinuousRate(continuousRateHz);
+        pushUI->setPaletteQuantization(paletteLevels);
+        pushUI->setSyncEngine(&syncEngine);
 
-            // Set up MIDI callback to handle Push 2 input
-            push.setMidiCallback([&pushUI](const PushMidiMessage& msg) {
-                if (pushUI) {
-                    pushUI->onMidiMessage(msg);
-                }
-            });
-
-            if (!pushUI->initialize()) {
-                std::cerr << "Failed to initialize Push UI" << std::endl;
-                pushUI.reset();
-                pushConnected = false;
+        // Set up MIDI callback to handle Push 2 input
+        push.setMidiCallback([&pushUI](const PushMidiMessage& msg) {
+            if (pushUI) {
+                pushUI->onMidiMessage(msg);
             }
+        });
+
+        if (!pushUI->initialize()) {
+            std::cerr << "Failed to initialize Push UI" << std::endl;
+            pushUI.reset();
+            pushConnected = false;
         }
 
         // 6. Create UDP socket for receiving OSC messages
         UdpListeningReceiveSocket socket(IpEndpointName(IpEndpointName::ANY_ADDRESS, incomingOscPort), &listener);
 
+        // On packet loss, distrust what the Push shows and re-query just that. The pads stay dimmed
+        // until the re-query for their window has been answered.
+        syncEngine.setCompletionHandler([&resolumeTracker](const std::vector<OSCSyncRequestResult>& results) {
+            for (const auto& result : results) {
+                if (result.answered > 0) {
+                    resolumeTracker.clearSuspect(result.covers);
+                }
+            }
+        });
+        OSCLossMonitor lossMonitor(incomingOscPort, listener, [&](const std::string&) {
+            OSCSyncWindow window = pushUI ? pushUI->getSyncWindow(false) : OSCSyncWindow{};
+            uint64_t syncId = syncEngine.reserveRequestId();
+            resolumeTracker.markSuspect(syncId, window.firstLayer, window.lastLayer, window.firstColumn, window.lastColumn);
+            syncEngine.requeryWindow(window, "packet loss", syncId);
+        });
+        lossMonitor.setTcpStream(tcpStream.get());
+
         std::cout << "Push2-Resolume Controller starting..." << std::endl;
         std::cout << "Listening for OSC messages on port " << incomingOscPort << std::endl;
-        std::cout << "Sending OSC messages to " << resolumeIp << ":" << resolumeOscPort << std::endl;
+        if (!tcpConnect.empty()) {
+            std::cout << "Sending OSC messages over TCP to " << tcpConnect << std::endl;
+        } else if (tcpListenPort >= 0) {
+            std::cout << "Accepting OSC over TCP on port " << tcpListenPort << std::endl;
+        } else {
+            std::cout << "Sending OSC messages to " << resolumeIp << ":" << resolumeOscPort << std::endl;
+        }
+        for (const auto& mirror : oscMirrors) {
+            std::cout << "Mirroring OSC messages to " << mirror.first << ":" << mirror.second << std::endl;
+        }
         std::cout << "Press 'q' + Enter to quit, 'help' for commands" << std::endl;
         
         // Start listening in a separate thread
@@ -113,24 +308,44 @@ int main(int argc, char* argv[]) {
                 shouldStop.store(true);
             }
         });
+
+        // Startup sync of the visible grid and its neighbours
+        syncEngine.requestSync(pushUI ? pushUI->getSyncWindow() : OSCSyncWindow{}, true, "startup");
         
-        // Main update loop
-        std::thread updateThread([&pushUI, &shouldStop]() {
-            constexpr int frameTimeMs = 1000 / 10; // ~100ms per frame for 10fps
-            while (!shouldStop.load()) {
-                auto start = std::chrono::steady_clock::now();
-                if (pushUI) {
-                    pushUI->update();
-                }
-                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    std::chrono::steady_clock::now() - start
-                ).count();
-                int sleepMs = frameTimeMs - static_cast<int>(elapsed);
-                if (sleepMs > 0) {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs));
+        // Redraw the Push when the tracker or the user changed something, at most at the configured rates
+        PushRefreshScheduler refreshScheduler(ledRateHz, displayRateHz);
+        if (pushUI) {
+            pushUI->setRefreshScheduler(&refreshScheduler);
+            resolumeTracker.setChangeObserver([&refreshScheduler]() {
+                refreshScheduler.notifyStateChanged();
+            });
+            refreshScheduler.start([&pushUI](PushFrameStages& stages) { pushUI->updateLights(stages); },
+                                   [&pushUI](PushFrameStages& stages) { pushUI->updateDisplay(stages); });
+
+            // Unplugging the Push only pauses it: reattach in the background and restore the LEDs,
+            // palette and display from what the UI already holds
+            push.startHotplug([&pushUI]() { pushUI->restoreDevice(); });
+        }
+
+        // Scripted input for the simulated Push 2
+        std::thread fakeScriptThread;
+        if (fakeDevice && !fakeScript.empty()) {
+            fakeScriptThread = std::thread([fakeDevice, fakeScript]() {
+                std::ifstream script(fakeScript);
+                if (!script) {
+                    std::cerr << "Could not open fake Push script " << fakeScript << std::endl;
+                    return;
                 }
+                int failures = fakeDevice->runScript(script);
+                std::cout << "Fake Push script finished" << (failures ? " with errors" : "") << std::endl;
+            });
+        }
+        
+        if (latencyBench) {
+            if (!pushUI || !latencyBench->run(*fakeDevice, resolumeTracker, benchOptions)) {
+                exitCode = 1;
             }
-        });
+        }
         
         // If in livetree mode, run the live tree display loop and exit
         if (liveTreeMode) {
@@ -145,7 +360,7 @@ int main(int argc, char* argv[]) {
 
         // Wait for user input to quit
         std::string input;
-        while (std::getline(std::cin, input)) {
+        while (!latencyBench && std::getline(std::cin, input)) {
             if (input == "q" || input == "Q") {
                 break;
             } else if (input == "clear") {
@@ -160,10 +375,41 @@ int main(int argc, char* argv[]) {
                 std::cout << "Push 2 connected: " << (pushConnected && push.isDeviceConnected() ? "Yes" : "No") << std::endl;
             } */else if (input == "tree" || input == "print") {
                 resolumeTracker.print();
+            } else if (input == "oscstats") {
+                oscSender->printStats();
+                if (pushUI && pushUI->getContinuousOutput()) {
+                    pushUI->getContinuousOutput()->printStats();
+                }
+                oscRelay.printStats();
+                syncEngine.printStats();
+                lossMonitor.printStats();
+            } else if (input == "midistats") {
+                push.printMidiInputStats();
+                push.printMidiOutputStats();
+                push.printHotplugStats();
+                if (pushUI) {
+                    pushUI->printLightStats();
+                }
+            } else if (input == "midibench") {
+                push.benchmarkGridRepaint();
+            } else if (input == "refreshstats") {
+                refreshScheduler.printStats();
+            } else if (input == "fakestats" && fakeDevice) {
+                fakeDevice->printStats();
+            } else if (input.rfind("fake ", 0) == 0 && fakeDevice) {
+                std::string error;
+                if (!fakeDevice->runScriptLine(input.substr(5), error)) {
+                    std::cerr << error << std::endl;
+                }
+            } else if (input == "palette") {
+                push.benchmarkPaletteReadback();
+            } else if (input == "sync") {
+                syncEngine.requestSync(pushUI ? pushUI->getSyncWindow() : OSCSyncWindow{}, true, "manual");
             } else if (input=="refresh") {
-                std::cout << "Forcing Push UI refresh" << std::endl;
-                pushUI->forceRefresh();
-                pushUI->update();
+                if (pushUI) {
+                    std::cout << "Forcing Push UI refresh" << std::endl;
+                    pushUI->forceRefresh();
+                }
             } else if (input == "help") {
                 std::cout << "\nAvailable commands:" << std::endl;
                 std::cout << "  q/Q      - Quit the program" << std::endl;
@@ -171,12 +417,23 @@ int main(int argc, char* argv[]) {
                 std::cout << "  status   - Show basic status information" << std::endl;
                 std::cout << "  tree     - Print complete state tree" << std::endl;
                 std::cout << "  print    - Same as tree" << std::endl;
+                std::cout << "  oscstats - Show OSC send count and encode+send timing" << std::endl;
+                std::cout << "  sync     - Re-query the visible state from Resolume" << std::endl;
+                std::cout << "  midistats - Show Push 2 MIDI input/output, queueing delay per priority, palette and hot-plug counters" << std::endl;
+                std::cout << "  midibench - Time a full pad grid repaint, unbatched vs batched" << std::endl;
+                std::cout << "  palette  - Read back all 128 palette entries and time it" << std::endl;
+                std::cout << "  refreshstats - Show LED/display frames, latency, deadline overruns and stage times" << std::endl;
                 if (pushConnected && pushUI) {
                     std::cout << "  test     - Run Push 2 lighting test" << std::endl;
                 }
+                if (fakeDevice) {
+                    std::cout << "  fake <line> - Run one fake Push script line, e.g. 'fake pad 36', 'fake touch 8192' or 'fake unplug'" << std::endl;
+                    std::cout << "  fakestats - Show what the simulated Push 2 received" << std::endl;
+                }
                 std::cout << "  help     - Show this help message" << std::endl;
                 std::cout << std::endl;
             } else if (input == "clipsgrid") {
+                auto trackerLock = resolumeTracker.readLock();
                 // loop through the first 8 layers and 8 columns and print x if a clip exists else _
                 for (int layer = 1; layer <= 8; ++layer) {
                     for (int col = 1; col <= 8; ++col) {
@@ -200,11 +457,22 @@ int main(int argc, char* argv[]) {
         }
         
         shouldStop.store(true);
+        push.stopHotplug();
+        socket.AsynchronousBreak();
         if (oscThread.joinable()) {
             oscThread.join();
         }
-        if (updateThread.joinable()) {
-            updateThread.join();
+        if (fakeDevice) {
+            fakeDevice->stopScript();
+        }
+        if (fakeScriptThread.joinable()) {
+            fakeScriptThread.join();
+        }
+        resolumeTracker.setChangeObserver(nullptr);
+        refreshScheduler.stop();
+        if (tcpStream) {
+            oscSender->setStream(nullptr);
+            tcpStream->stop();
         }
         
         std::cout << "Push2-Resolume Controller stopped." << std::endl;
@@ -217,5 +485,5 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    return 0;
+    return exitCode;
 }
\ No newline at end of file